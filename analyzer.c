@@ -5,7 +5,100 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-analysis_result_t analyze_signal_buffer(const uint32_t *buffer, uint32_t word_count, double sample_rate) {
+#include "units.h"
+
+static inline uint32_t popcount32(uint32_t w) {
+#if defined(__GNUC__)
+    return __builtin_popcount(w);
+#else
+    w = w - ((w >> 1) & 0x55555555u);
+    w = (w & 0x33333333u) + ((w >> 2) & 0x33333333u);
+    w = (w + (w >> 4)) & 0x0F0F0F0Fu;
+    return (w * 0x01010101u) >> 24;
+#endif
+}
+
+// Fill the derived fields of the result from the raw counters
+static void finish_analysis(analysis_result_t *res, uint32_t word_count, uint32_t sample_rate,
+                            uint32_t high_count, uint32_t transitions,
+                            const uint32_t pulse_widths[2], const uint32_t pulse_counts[2]) {
+    uint32_t total_samples = word_count * 32;
+
+    res->high_count = high_count;
+    res->transitions = transitions;
+    res->pulse_widths[0] = pulse_widths[0];
+    res->pulse_widths[1] = pulse_widths[1];
+    res->total_samples = total_samples;
+    res->word_count = word_count;
+    // compute duty cycle (basis points of HIGH samples)
+    if (total_samples > 0) {
+        res->duty_bp = (uint32_t)((uint64_t)high_count * 10000 / total_samples);
+    } else {
+        res->duty_bp = 0;
+    }
+
+    // transitions / 2 periods in total_samples / sample_rate seconds
+    if (transitions > 1 && sample_rate > 0) {
+        res->capture_duration_us = (uint32_t)scaled_div(total_samples, 1000000, sample_rate);
+        res->estimated_freq_mhz = scaled_div((uint64_t)transitions * sample_rate, 500, total_samples);
+    } else {
+        res->capture_duration_us = 0;
+        res->estimated_freq_mhz = 0;
+    }
+
+    // compute average pulse widths per pulse (in samples)
+    if (pulse_counts[1] > 0) res->avg_high_pulse_q8 = (uint32_t)(((uint64_t)res->pulse_widths[1] << 8) / pulse_counts[1]);
+    else res->avg_high_pulse_q8 = 0;
+    if (pulse_counts[0] > 0) res->avg_low_pulse_q8 = (uint32_t)(((uint64_t)res->pulse_widths[0] << 8) / pulse_counts[0]);
+    else res->avg_low_pulse_q8 = 0;
+
+    if (transitions == 0) res->signal_type = SIGNAL_TYPE_CONSTANT;
+    else if (transitions == 2 && high_count == total_samples / 2) res->signal_type = SIGNAL_TYPE_PERFECT_SQUARE;
+    else if (transitions >= 4) res->signal_type = SIGNAL_TYPE_PERIODIC;
+    else res->signal_type = SIGNAL_TYPE_UNKNOWN;
+}
+
+// Word-parallel kernel: every word is compared against itself shifted by one
+// sample (with the last sample of the previous word carried in), so each set
+// bit of `edges` is one transition. Rising edges start a HIGH run and falling
+// edges start a LOW run, which gives the run counts without walking the runs;
+// the run lengths per level sum up to the sample count of that level.
+analysis_result_t analyze_signal_buffer(const uint32_t *buffer, uint32_t word_count, uint32_t sample_rate) {
+    analysis_result_t res = {0};
+    uint32_t high_count = 0;
+    uint32_t rising = 0;
+    uint32_t falling = 0;
+    uint32_t first_state = (buffer[0] & 1);
+    uint32_t last_state = first_state;
+
+    for (uint32_t i = 0; i < word_count; i++) {
+        uint32_t word = buffer[i];
+
+        if (i < 10) res.first_words[i] = word;
+
+        // all-0 / all-1 word continuing the current level: nothing but the level count changes
+        if (word == 0 && last_state == 0) continue;
+        if (word == 0xFFFFFFFFu && last_state == 1) {
+            high_count += 32;
+            continue;
+        }
+
+        uint32_t edges = word ^ ((word << 1) | last_state);
+        rising += popcount32(edges & word);
+        falling += popcount32(edges & ~word);
+        high_count += popcount32(word);
+        last_state = word >> 31;
+    }
+
+    uint32_t pulse_widths[2] = {word_count * 32 - high_count, high_count};
+    uint32_t pulse_counts[2] = {falling + (first_state ^ 1), rising + first_state};
+
+    finish_analysis(&res, word_count, sample_rate, high_count, rising + falling, pulse_widths, pulse_counts);
+    return res;
+}
+
+// Bit-serial reference implementation, kept to validate and benchmark the word-parallel kernel
+analysis_result_t analyze_signal_buffer_bitwise(const uint32_t *buffer, uint32_t word_count, uint32_t sample_rate) {
     analysis_result_t res = {0};
     uint32_t high_count = 0;
     uint32_t transitions = 0;
@@ -41,122 +134,566 @@ analysis_result_t analyze_signal_buffer(const uint32_t *buffer, uint32_t word_co
     pulse_widths[last_state] += current_pulse_length;
     pulse_counts[last_state]++;
 
-    uint32_t total_samples = word_count * 32;
+    finish_analysis(&res, word_count, sample_rate, high_count, transitions, pulse_widths, pulse_counts);
+    return res;
+}
 
-    res.high_count = high_count;
-    res.transitions = transitions;
-    res.pulse_widths[0] = pulse_widths[0];
-    res.pulse_widths[1] = pulse_widths[1];
-    res.total_samples = total_samples;
-    res.word_count = word_count;
-    // compute duty cycle (% of HIGH samples)
-    if (total_samples > 0) {
-        res.duty_cycle = ((float)high_count / (float)total_samples) * 100.0f;
-    } else {
-        res.duty_cycle = 0.0f;
+static inline uint32_t count_trailing_zeros32(uint32_t w) {
+#if defined(__GNUC__)
+    return __builtin_ctz(w);
+#else
+    uint32_t n = 0;
+    while (!(w & 1u)) { w >>= 1; n++; }
+    return n;
+#endif
+}
+
+void edge_list_init(edge_list_t *list, edge_run_t *runs, uint32_t capacity) {
+    list->runs = runs;
+    list->capacity = capacity;
+    list->mark_shift = 0;
+    while (capacity > (uint32_t)EDGE_LIST_MARKS << list->mark_shift) list->mark_shift++;
+    list->stats.glitch_threshold = 0;
+    edge_list_reset(list);
+}
+
+void edge_list_set_glitch_threshold(edge_list_t *list, uint32_t samples) {
+    list->stats.glitch_threshold = samples;
+}
+
+void edge_list_reset(edge_list_t *list) {
+    list->count = 0;
+    list->truncated = false;
+    list->stored_samples = 0;
+    list->total_samples = 0;
+    list->high_count = 0;
+    list->rising = 0;
+    list->falling = 0;
+    list->first_level = 0;
+    list->level = 0;
+    list->run_length = 0;
+
+    uint32_t glitch_threshold = list->stats.glitch_threshold;
+    memset(&list->stats, 0, sizeof(list->stats));
+    list->stats.glitch_threshold = glitch_threshold;
+    list->stats.width[0].min = UINT32_MAX;
+    list->stats.width[1].min = UINT32_MAX;
+    list->stats.period.min = UINT32_MAX;
+}
+
+static inline void run_stats_add(run_stats_t *stats, uint32_t length) {
+    stats->count++;
+    if (length < stats->min) stats->min = length;
+    if (length > stats->max) stats->max = length;
+    stats->sum += length;
+    stats->sum_sq += (uint64_t)length * length;
+}
+
+static inline uint32_t log2_32(uint32_t w) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(w);
+#else
+    uint32_t n = 0;
+    while (w >>= 1) n++;
+    return n;
+#endif
+}
+
+// Every closed run but the leading one is complete: one update per edge
+static inline void pulse_stats_add(pulse_stats_t *stats, uint32_t level, uint32_t length) {
+    if (stats->closed++ == 0) return;
+
+    run_stats_add(&stats->width[level], length);
+    if (length < stats->glitch_threshold) stats->glitches++;
+
+    uint32_t bin = log2_32(length);
+    stats->histogram[bin < PULSE_HISTOGRAM_BINS ? bin : PULSE_HISTOGRAM_BINS - 1]++;
+
+    if (level) {
+        stats->last_high = length;
+    } else if (stats->last_high) {
+        run_stats_add(&stats->period, stats->last_high + length);
     }
+}
 
-    if (transitions > 1) {
-        res.capture_duration_s = (double)total_samples / sample_rate;
-        res.estimated_freq = (transitions / 2.0) / res.capture_duration_s;
+static inline void edge_list_store(edge_list_t *list, uint32_t level, uint32_t length) {
+    if (list->count < list->capacity) {
+        if ((list->count & ((1u << list->mark_shift) - 1)) == 0) {
+            list->marks[list->count >> list->mark_shift] = list->stored_samples;
+        }
+        list->runs[list->count].level = level;
+        list->runs[list->count].length = length;
+        list->stored_samples += length;
+        list->count++;
     } else {
-        res.capture_duration_s = 0.0;
-        res.estimated_freq = 0.0;
+        list->truncated = true;
     }
+}
 
-    // compute average pulse widths per pulse (in samples)
-    if (pulse_counts[1] > 0) res.avg_high_pulse = (float)res.pulse_widths[1] / (float)pulse_counts[1];
-    else res.avg_high_pulse = 0.0f;
-    if (pulse_counts[0] > 0) res.avg_low_pulse = (float)res.pulse_widths[0] / (float)pulse_counts[0];
-    else res.avg_low_pulse = 0.0f;
+// Closes a run at an edge
+static inline void edge_list_push(edge_list_t *list, uint32_t level, uint32_t length) {
+    pulse_stats_add(&list->stats, level, length);
+    edge_list_store(list, level, length);
+}
 
-    if (transitions == 0) res.signal_type = SIGNAL_TYPE_CONSTANT;
-    else if (transitions == 2 && high_count == total_samples / 2) res.signal_type = SIGNAL_TYPE_PERFECT_SQUARE;
-    else if (transitions >= 4) res.signal_type = SIGNAL_TYPE_PERIODIC;
-    else res.signal_type = SIGNAL_TYPE_UNKNOWN;
+// Appends samples to the list. Transitions inside a word are found the same
+// way as in analyze_signal_buffer; while there is room for more runs, the
+// set bits of the transition mask are walked with ctz to cut the word into
+// runs. Once the list is full the runs still go into the statistics, they
+// are just not stored.
+void edge_list_append(edge_list_t *list, const uint32_t *buffer, uint32_t word_count) {
+    edge_list_append_strided(list, buffer, word_count, 1);
+}
 
-    return res;
+void edge_list_append_strided(edge_list_t *list, const uint32_t *buffer, uint32_t word_count, uint32_t stride) {
+    if (word_count == 0) return;
+
+    if (list->total_samples == 0) {
+        list->first_level = buffer[0] & 1;
+        list->level = list->first_level;
+    }
+
+    uint32_t level = list->level;
+    uint32_t run_length = list->run_length;
+
+    for (uint32_t i = 0; i < word_count; i++) {
+        uint32_t word = buffer[i * stride];
+
+        // all-0 / all-1 word continuing the current run
+        if ((word == 0 && level == 0) || (word == 0xFFFFFFFFu && level == 1)) {
+            run_length += 32;
+            if (level) list->high_count += 32;
+            continue;
+        }
+
+        uint32_t edges = word ^ ((word << 1) | level);
+        list->rising += popcount32(edges & word);
+        list->falling += popcount32(edges & ~word);
+        list->high_count += popcount32(word);
+
+        uint32_t pos = 0;
+        while (edges) {
+            uint32_t bit = count_trailing_zeros32(edges);
+            edge_list_push(list, level, run_length + bit - pos);
+            run_length = 0;
+            pos = bit;
+            level ^= 1;
+            edges &= edges - 1;
+        }
+        run_length += 32 - pos;
+    }
+
+    list->level = level;
+    list->run_length = run_length;
+    list->total_samples += word_count * 32;
 }
 
-float calculate_duty_cycle(const uint32_t *buffer, uint32_t word_count) {
-    if (!buffer || word_count == 0) return 0.0f;
-    uint64_t high_count = 0;
+void edge_list_finish(edge_list_t *list) {
+    // the open run has no closing edge, it is stored but not part of the statistics
+    if (list->total_samples > 0 && !list->truncated) {
+        edge_list_store(list, list->level, list->run_length);
+    }
+    list->run_length = 0;
+}
+
+void edge_list_build(edge_list_t *list, const uint32_t *buffer, uint32_t word_count) {
+    edge_list_reset(list);
+    edge_list_append(list, buffer, word_count);
+    edge_list_finish(list);
+}
+
+// Count field of an RLE word. Between the cycles that see its edges a low run
+// takes 2 * count + 7 cycles and a high run 2 * count + 5 (see sampler_rle).
+#define RLE_COUNT_MAX 0x7FFFFFFFu
+#define RLE_OVERHEAD_LOW 7
+#define RLE_OVERHEAD_HIGH 5
+
+void edge_list_append_rle(edge_list_t *list, const uint32_t *words, uint32_t word_count) {
     for (uint32_t i = 0; i < word_count; i++) {
-        uint32_t w = buffer[i];
-        // popcount for speed if available
-#if defined(__GNUC__)
-        high_count += __builtin_popcount(w);
-#else
-        for (int b = 0; b < 32; b++) {
-            high_count += (w >> b) & 1u;
+        uint32_t level = words[i] & 1;
+        uint32_t count = RLE_COUNT_MAX - (words[i] >> 1);
+        uint32_t length = 2 * count + (level ? RLE_OVERHEAD_HIGH : RLE_OVERHEAD_LOW);
+
+        if (list->total_samples == 0) {
+            list->first_level = level;
+            list->level = level;
         }
-#endif
+        if (level != list->level) {
+            edge_list_push(list, list->level, list->run_length);
+            if (level) list->rising++;
+            else list->falling++;
+            list->level = level;
+            list->run_length = 0;
+        }
+        list->run_length += length;
+        list->total_samples += length;
+        if (level) list->high_count += length;
     }
-    uint64_t total = (uint64_t)word_count * 32ull;
-    if (total == 0) return 0.0f;
-    return ((float)high_count / (float)total) * 100.0f;
 }
 
-bool detect_signal_activity(const uint32_t *buffer, uint32_t word_count) {
-    uint32_t check_words = word_count;
-    uint8_t last_state = (buffer[0] & 1);
+// Stored run holding `sample` and its first sample: a binary search over the
+// marks, then fewer than 2^mark_shift runs forward. list->count past the stored runs.
+static uint32_t edge_list_seek(const edge_list_t *list, uint32_t sample, uint32_t *run_start) {
+    if (sample >= list->stored_samples) {
+        *run_start = list->stored_samples;
+        return list->count;
+    }
 
-    for (uint32_t i = 0; i < check_words; i++) {
-        uint32_t word = buffer[i];
+    uint32_t lo = 0;
+    uint32_t hi = (list->count - 1) >> list->mark_shift;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1) / 2;
+        if (list->marks[mid] <= sample) lo = mid;
+        else hi = mid - 1;
+    }
+    uint32_t run = lo << list->mark_shift;
+    uint32_t start = list->marks[lo];
+    while (start + list->runs[run].length <= sample) {
+        start += list->runs[run].length;
+        run++;
+    }
+    *run_start = start;
+    return run;
+}
 
-        for (int bit = 0; bit < 32; bit++) {
-            uint8_t current_state = (word >> bit) & 1;
-            if (current_state != last_state) {
-                return true;
+uint32_t edge_list_run_at(const edge_list_t *list, uint32_t sample) {
+    uint32_t start;
+    return edge_list_seek(list, sample, &start);
+}
+
+// Gathers every second bit into the low half and the others into the high half
+static inline uint32_t unshuffle32(uint32_t x) {
+    uint32_t t;
+    t = (x ^ (x >> 1)) & 0x22222222u; x ^= t ^ (t << 1);
+    t = (x ^ (x >> 2)) & 0x0C0C0C0Cu; x ^= t ^ (t << 2);
+    t = (x ^ (x >> 4)) & 0x00F000F0u; x ^= t ^ (t << 4);
+    t = (x ^ (x >> 8)) & 0x0000FF00u; x ^= t ^ (t << 8);
+    return x;
+}
+
+// Bit k * n + c of an interleaved word is sample k of channel c. log2(n)
+// unshuffles sort each word into n fields of 32 / n samples, field c holding
+// channel c; the n x n matrix of fields of a group is then transposed so that
+// word c of the group holds 32 consecutive samples of channel c.
+void deinterleave_channels(uint32_t *buffer, uint32_t word_count, uint8_t channel_count) {
+    if (channel_count <= 1) return;
+
+    uint32_t passes = count_trailing_zeros32(channel_count);
+    uint32_t field_bits = 32 / channel_count;
+    uint32_t field_mask = (1u << field_bits) - 1;
+    uint32_t group[8];
+
+    for (uint32_t g = 0; g + channel_count <= word_count; g += channel_count) {
+        uint32_t *words = &buffer[g];
+        for (uint32_t j = 0; j < channel_count; j++) {
+            uint32_t x = words[j];
+            for (uint32_t p = 0; p < passes; p++) x = unshuffle32(x);
+            group[j] = x;
+        }
+        for (uint32_t c = 0; c < channel_count; c++) {
+            uint32_t plane = 0;
+            for (uint32_t j = 0; j < channel_count; j++) {
+                plane |= ((group[j] >> (c * field_bits)) & field_mask) << (j * field_bits);
             }
-            last_state = current_state;
+            words[c] = plane;
         }
     }
-    return false;
 }
 
-// Helper to get a single sample bit at global sample index
-static inline uint8_t get_sample_bit(const uint32_t *buffer, uint32_t sample_index) {
-    uint32_t word_idx = sample_index >> 5; // /32
-    uint32_t bit = sample_index & 31;
-    return (buffer[word_idx] >> bit) & 1u;
+void pyramid_init(pyramid_t *pyramid, uint32_t *storage, uint32_t capacity) {
+    pyramid->storage = storage;
+    pyramid->capacity = capacity;
+    pyramid_reset(pyramid);
 }
 
-void reduce_buffer_to_32(const uint32_t *buffer, uint32_t word_count, reduce_t out[128], uint32_t avg_fullpulse_width) {
-    uint8_t current_state;
-    uint8_t current_pulse_length;
-    uint8_t last_state = get_sample_bit(buffer, 0);
-    uint8_t cursor = 0;  
-    bool force_transition = false;
-    bool first_sampleset = true;
+// Level 0 takes the largest share of the storage whose upper levels still
+// fit behind it (see PYRAMID_STORAGE_WORDS), whatever the final word count
+void pyramid_reset(pyramid_t *pyramid) {
+    pyramid->levels = 0;
+    pyramid->total_samples = 0;
+    pyramid->buckets[0] = 0;
+    pyramid->plane_words[0] = pyramid->capacity > 3 * PYRAMID_MAX_LEVELS ? (pyramid->capacity - 3 * PYRAMID_MAX_LEVELS) / 6 : 0;
+    pyramid->planes[0] = pyramid->storage;
+}
+
+// Bit i of the result is bits 2i and 2i + 1 of b:a ORed together
+static inline uint32_t pair_or(uint32_t a, uint32_t b) {
+    a = unshuffle32(a | (a >> 1)) & 0xFFFFu;
+    b = unshuffle32(b | (b >> 1)) & 0xFFFFu;
+    return a | (b << 16);
+}
+
+// Level 0 takes the word-parallel transition mask of analyze_signal_buffer per
+// word, 32 buckets to a plane word; a plane word left half filled by the
+// previous block is picked up again.
+void pyramid_append(pyramid_t *pyramid, const uint32_t *buffer, uint32_t word_count, uint32_t stride) {
+    uint32_t plane_words = pyramid->plane_words[0];
+    uint32_t *high = pyramid->planes[0];
+    uint32_t *low = high + plane_words;
+    uint32_t *edge = low + plane_words;
+    uint32_t index = pyramid->buckets[0];
+    if (word_count > plane_words * 32 - index) word_count = plane_words * 32 - index;
+    if (word_count == 0) return;
 
-    uint32_t offset = 1;
-    
-    for (; offset < word_count * 32; ++offset) {
-        current_state = get_sample_bit(buffer, offset);
-        if (last_state != current_state) {
-            last_state = current_state;
-            break;
+    uint32_t last = index ? pyramid->last : buffer[0] & 1;
+    uint32_t w = 0;
+    while (w < word_count) {
+        uint32_t p = index / 32;
+        uint32_t b = index % 32;
+        uint32_t h = b ? high[p] : 0, l = b ? low[p] : 0, e = b ? edge[p] : 0;
+        for (; b < 32 && w < word_count; b++, w++) {
+            uint32_t word = buffer[w * stride];
+            h |= (uint32_t)(word != 0) << b;
+            l |= (uint32_t)(word != 0xFFFFFFFFu) << b;
+            e |= (uint32_t)((word ^ ((word << 1) | last)) != 0) << b;
+            last = word >> 31;
         }
+        high[p] = h;
+        low[p] = l;
+        edge[p] = e;
+        index = p * 32 + b;
     }
+    pyramid->buckets[0] = index;
+    pyramid->last = last;
+}
 
+// Every level above 0 ORs bucket pairs 32 at a time, which adds up to a
+// sixteenth of the level 0 work
+void pyramid_finish(pyramid_t *pyramid) {
+    pyramid->levels = 0;
+    pyramid->total_samples = pyramid->buckets[0] * 32;
+    if (pyramid->buckets[0] == 0) return;
+    pyramid->levels = 1;
 
-    for (uint32_t i = offset; i < word_count * 32; i++) {
-        current_state = get_sample_bit(buffer, i);
+    uint32_t used = 3 * pyramid->plane_words[0];
+    while (pyramid->levels < PYRAMID_MAX_LEVELS && pyramid->buckets[pyramid->levels - 1] > 1) {
+        uint32_t level = pyramid->levels;
+        uint32_t src_words = pyramid->plane_words[level - 1];
+        uint32_t src_used = (pyramid->buckets[level - 1] + 31) / 32;
+        uint32_t buckets = (pyramid->buckets[level - 1] + 1) / 2;
+        uint32_t plane_words = (buckets + 31) / 32;
+        if (used + 3 * plane_words > pyramid->capacity) break;
 
-        if (force_transition || current_state != last_state) {
-            if (current_pulse_length > avg_fullpulse_width / 2 ) {
-                out[cursor++] = last_state;             
-            } else {
-                out[cursor++] = reduced_pin;
+        const uint32_t *src = pyramid->planes[level - 1];
+        uint32_t *dst = pyramid->storage + used;
+        for (uint32_t plane = 0; plane < 3; plane++) {
+            for (uint32_t p = 0; p < plane_words; p++) {
+                uint32_t a = src[plane * src_words + 2 * p];
+                uint32_t b = 2 * p + 1 < src_used ? src[plane * src_words + 2 * p + 1] : 0;
+                dst[plane * plane_words + p] = pair_or(a, b);
+            }
+        }
+        pyramid->planes[level] = dst;
+        pyramid->plane_words[level] = plane_words;
+        pyramid->buckets[level] = buckets;
+        pyramid->levels++;
+        used += 3 * plane_words;
+    }
+}
+
+void pyramid_build(pyramid_t *pyramid, const uint32_t *buffer, uint32_t word_count, uint32_t stride) {
+    pyramid_reset(pyramid);
+    pyramid_append(pyramid, buffer, word_count, stride);
+    pyramid_finish(pyramid);
+}
+
+uint8_t pyramid_bucket(const pyramid_t *pyramid, uint32_t level, uint32_t index) {
+    if (level >= pyramid->levels || index >= pyramid->buckets[level]) return 0;
+    uint32_t plane_words = pyramid->plane_words[level];
+    const uint32_t *word = &pyramid->planes[level][index / 32];
+    uint32_t bit = index % 32;
+    return ((word[0] >> bit) & 1) * PYRAMID_HIGH
+         | ((word[plane_words] >> bit) & 1) * PYRAMID_LOW
+         | ((word[2 * plane_words] >> bit) & 1) * PYRAMID_EDGE;
+}
+
+// Level 0 buckets covering samples from .. to - 1
+static uint8_t pyramid_span(const pyramid_t *pyramid, uint32_t from, uint32_t to) {
+    uint8_t flags = 0;
+    if (pyramid->levels == 0) return 0;
+    for (uint32_t i = from >> PYRAMID_BUCKET_SHIFT; i <= (to - 1) >> PYRAMID_BUCKET_SHIFT; i++) {
+        flags |= pyramid_bucket(pyramid, 0, i);
+    }
+    return flags;
+}
+
+// Columns narrower than a bucket walk the runs overlapping the window: a run
+// start inside a column is an edge there. Past the stored runs of a truncated
+// list the level 0 buckets are all that is left.
+static void render_runs(const pyramid_t *pyramid, const edge_list_t *list, uint32_t start, uint32_t width,
+                        uint8_t *columns, uint32_t count) {
+    // found once, the columns then walk forward from it
+    uint32_t run_start;
+    uint32_t run = edge_list_seek(list, start, &run_start);
+
+    for (uint32_t c = 0; c < count; c++) {
+        uint32_t from = start + c * width;
+        uint32_t to = from + width;
+        if (from >= list->total_samples) {
+            columns[c] = 0;
+            continue;
+        }
+        while (run < list->count && run_start + list->runs[run].length <= from) {
+            run_start += list->runs[run].length;
+            run++;
+        }
+        if (run >= list->count) {
+            columns[c] = pyramid_span(pyramid, from, to);
+            continue;
+        }
+
+        uint8_t flags = run > 0 && run_start == from ? PYRAMID_EDGE : 0;
+        while (true) {
+            flags |= list->runs[run].level ? PYRAMID_HIGH : PYRAMID_LOW;
+            uint32_t run_end = run_start + list->runs[run].length;
+            if (run_end >= to) break;
+            if (run + 1 >= list->count) {
+                if (list->truncated) flags |= pyramid_span(pyramid, run_end, to);
+                break;
             }
-            if (cursor == 128)
-                return;
+            run_start = run_end;
+            run++;
+            flags |= PYRAMID_EDGE;
+        }
+        columns[c] = flags;
+    }
+}
+
+void render_columns(const pyramid_t *pyramid, const edge_list_t *list, uint32_t start, uint32_t zoom,
+                    uint8_t *columns, uint32_t count) {
+    if (zoom < PYRAMID_BUCKET_SHIFT || zoom - PYRAMID_BUCKET_SHIFT >= pyramid->levels) {
+        render_runs(pyramid, list, start, 1u << zoom, columns, count);
+        return;
+    }
+    uint32_t level = zoom - PYRAMID_BUCKET_SHIFT;
+    uint32_t first = start >> zoom;
+    for (uint32_t c = 0; c < count; c++) {
+        columns[c] = pyramid_bucket(pyramid, level, first + c);
+    }
+}
+
+analysis_result_t analyze_edge_list(const edge_list_t *list, uint32_t sample_rate) {
+    analysis_result_t res = {0};
+    uint32_t high_count = list->high_count;
+    uint32_t pulse_widths[2] = {list->total_samples - high_count, high_count};
+    uint32_t pulse_counts[2] = {list->falling + (list->first_level ^ 1), list->rising + list->first_level};
+
+    finish_analysis(&res, list->total_samples / 32, sample_rate, high_count, list->rising + list->falling, pulse_widths, pulse_counts);
+    return res;
+}
+
+static uint32_t isqrt64(uint64_t x) {
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+uint32_t run_stats_mean_q8(const run_stats_t *stats) {
+    if (stats->count == 0) return 0;
+    return (uint32_t)((stats->sum << 8) / stats->count);
+}
+
+// With sum_sq = q1 * n + r1 and sum = q2 * n + r2 the variance is
+// q1 - q2^2 + (r1 - 2 * q2 * r2) / n - (r2 / n)^2; q2 * r2 < sum, so every
+// term fits in 16.16 unless the runs are longer than ~11M samples, which
+// only leaves the whole samples.
+uint32_t run_stats_stddev_q8(const run_stats_t *stats) {
+    if (stats->count < 2) return 0;
+    uint64_t n = stats->count;
+    uint64_t q1 = stats->sum_sq / n, r1 = stats->sum_sq % n;
+    uint64_t q2 = stats->sum / n, r2 = stats->sum % n;
+    int64_t whole = (int64_t)(q1 - q2 * q2);
+
+    if (q1 >= (1ull << 47)) {
+        return whole > 0 ? isqrt64(whole) << 8 : 0;
+    }
+    int64_t f = (int64_t)((r2 << 16) / n);
+    int64_t variance_q16 = whole * 65536 + ((int64_t)r1 - 2 * (int64_t)(q2 * r2)) * 65536 / (int64_t)n - ((f * f) >> 16);
+    return variance_q16 > 0 ? isqrt64(variance_q16) : 0;
+}
+
+uint32_t calculate_duty_cycle(const edge_list_t *list) {
+    if (list->total_samples == 0) return 0;
+    return (uint32_t)((uint64_t)list->high_count * 10000 / list->total_samples);
+}
+
+bool detect_signal_activity(const edge_list_t *list) {
+    return list->rising + list->falling > 0;
+}
+
+void convergence_reset(convergence_t *conv) {
+    conv->transitions = 0;
+    conv->total_samples = 0;
+    conv->high_count = 0;
+    conv->agreed = 0;
+    conv->blocks = 0;
+}
+
+// Longest run of a level seen so far, the one still open included
+static uint32_t longest_run(const edge_list_t *list, uint32_t level) {
+    uint32_t longest = list->stats.width[level].max;
+    if (list->level == level && list->run_length > longest) longest = list->run_length;
+    return longest;
+}
+
+bool convergence_update(convergence_t *conv, const edge_list_t *list) {
+    uint32_t transitions = list->rising + list->falling;
+    uint32_t block_transitions = transitions - conv->transitions;
+    uint32_t block_samples = list->total_samples - conv->total_samples;
+    uint32_t block_high = list->high_count - conv->high_count;
+    // a period holds the longest run of either level, so it is at least this long
+    uint64_t cycle = (uint64_t)longest_run(list, 0) + longest_run(list, 1);
+
+    bool agrees = false;
+    if (conv->blocks > 0 && block_transitions > 0 && block_samples > 0) {
+        // block T_b / S_b against the running T / S, cross-multiplied
+        uint64_t block_rate = (uint64_t)block_transitions * list->total_samples;
+        uint64_t rate = (uint64_t)transitions * block_samples;
+        uint64_t change = block_rate > rate ? block_rate - rate : rate - block_rate;
+        uint32_t duty_bp = calculate_duty_cycle(list);
+        uint32_t block_duty_bp = (uint32_t)((uint64_t)block_high * 10000 / block_samples);
+        uint32_t duty_change = block_duty_bp > duty_bp ? block_duty_bp - duty_bp : duty_bp - block_duty_bp;
+        // a transition more or less, or a pulse cut at either end of the block
+        agrees = scaled_div(change, 1000000, rate) <= conv->tolerance_ppm + 1000000 / block_transitions &&
+                 duty_change <= conv->duty_tolerance_bp + 10000 / block_transitions;
+    }
+
+    conv->agreed = agrees ? conv->agreed + 1 : 0;
+    conv->transitions = transitions;
+    conv->total_samples = list->total_samples;
+    conv->high_count = list->high_count;
+    conv->blocks++;
+
+    // ending part way into a period puts the running estimate off by up to cycle / S
+    uint64_t samples = list->total_samples;
+    return conv->agreed >= conv->agree_blocks && transitions >= conv->min_transitions &&
+           samples * conv->tolerance_ppm >= cycle * 1000000 && samples * conv->duty_tolerance_bp >= cycle * 10000;
+}
+
+// Classifies the complete runs of the list: the leading run starts before the
+// capture and the open run at the end has no closing edge, so both are skipped.
+void reduce_edges_to_32(const edge_list_t *list, uint32_t first_run, reduce_t out[128], uint32_t avg_fullpulse_width) {
+    uint32_t end = list->truncated ? list->count : (list->count > 0 ? list->count - 1 : 0);
+    uint8_t cursor = 0;
 
-            current_pulse_length = 1;
-            last_state = current_state;
+    for (uint32_t i = first_run > 0 ? first_run : 1; i < end; i++) {
+        const edge_run_t *run = &list->runs[i];
+        if (run->length > avg_fullpulse_width / 2) {
+            out[cursor++] = run->level;
         } else {
-            current_pulse_length++;
+            out[cursor++] = reduced_pin;
         }
+        if (cursor == 128)
+            return;
     }
 }
@@ -12,37 +12,205 @@ typedef enum {
     SIGNAL_TYPE_PERIODIC
 } signal_type_t;
 
-// signal analyzer result structure
+// signal analyzer result structure, integer units of units.h
 typedef struct {
     uint32_t high_count;
     uint32_t transitions;
     uint32_t pulse_widths[2]; // [0] low, [1] high (sum of lengths)
     uint32_t total_samples;
-    double capture_duration_s;
-    double estimated_freq;
-    float avg_high_pulse;
-    float avg_low_pulse;
+    uint32_t capture_duration_us;
+    uint64_t estimated_freq_mhz; // milli-Hz
+    uint32_t avg_high_pulse_q8;  // samples, 24.8 fixed point
+    uint32_t avg_low_pulse_q8;
     uint32_t first_words[10];
     uint32_t word_count;
-    float duty_cycle; // duty cycle in percent (0.0 - 100.0)
+    uint32_t duty_bp; // duty cycle in basis points (0 - 10000)
     signal_type_t signal_type;
 } analysis_result_t;
 
-typedef enum: int8_t {
+// One run of constant level in the sample stream
+typedef struct {
+    uint32_t length : 31; // run length in samples
+    uint32_t level : 1;
+} edge_run_t;
+
+// Log2 bins of the pulse width histogram: bin b counts runs of 2^b .. 2^(b+1) - 1
+// samples, the last bin everything longer
+#define PULSE_HISTOGRAM_BINS 16
+
+// Accumulators of one run length statistic. The lengths of a capture sum up to
+// at most 2^32 samples, so the integer sum of squares cannot overflow and
+// nothing is rounded before the final division.
+typedef struct {
+    uint32_t count;
+    uint32_t min;               // UINT32_MAX while count is 0
+    uint32_t max;
+    uint64_t sum;
+    uint64_t sum_sq;
+} run_stats_t;
+
+// Statistics over the complete runs of a capture; the run open at the start
+// and the one still open at the end are partial and left out
+typedef struct {
+    run_stats_t width[2];       // pulse widths, [0] low, [1] high
+    run_stats_t period;         // rising edge to rising edge
+    uint32_t glitch_threshold;  // runs shorter than this are glitches, 0 = off
+    uint32_t glitches;
+    uint32_t histogram[PULSE_HISTOGRAM_BINS]; // widths of both levels
+    uint32_t closed;            // runs closed so far, including the leading one
+    uint32_t last_high;         // length of the last complete high run, 0 if none
+} pulse_stats_t;
+
+// Marks of an edge list: where every 2^mark_shift-th stored run starts, so a
+// sample is found with a binary search and a short walk
+#define EDGE_LIST_MARKS 64
+
+// Run-length (edge list) form of a capture. Runs are stored until `capacity`
+// is reached; the totals always cover every appended sample.
+typedef struct {
+    edge_run_t *runs;
+    uint32_t capacity;
+    uint32_t count;         // runs stored
+    bool truncated;         // capture had more runs than capacity
+    uint32_t stored_samples; // covered by the stored runs, total_samples unless truncated (once finished)
+    uint32_t mark_shift;    // set from the capacity so that EDGE_LIST_MARKS marks cover it
+    uint32_t marks[EDGE_LIST_MARKS]; // first sample of stored run i << mark_shift
+    uint32_t total_samples;
+    uint32_t high_count;
+    uint32_t rising;        // LOW -> HIGH transitions
+    uint32_t falling;       // HIGH -> LOW transitions
+    uint8_t first_level;    // level of the first sample
+    uint8_t level;          // level of the run still open at the end
+    uint32_t run_length;    // length of the run still open at the end
+    pulse_stats_t stats;    // covers every run, also those beyond capacity
+} edge_list_t;
+
+// One element of the display pattern, a byte each (kept C11 for the host build)
+enum {
     reduced_zero = 0,
     reduced_one  = 1,
     reduced_pin  = 2
-} reduce_t;
+};
+typedef int8_t reduce_t;
+
+// Analyze buffer and return populated result, sample_rate in Hz
+analysis_result_t analyze_signal_buffer(const uint32_t *buffer, uint32_t word_count, uint32_t sample_rate);
+
+// Bit-serial reference of analyze_signal_buffer (same result, one sample per iteration)
+analysis_result_t analyze_signal_buffer_bitwise(const uint32_t *buffer, uint32_t word_count, uint32_t sample_rate);
+
+// Edge list: bind storage, then either build it from a whole buffer or
+// reset / append blocks / finish it incrementally
+void edge_list_init(edge_list_t *list, edge_run_t *runs, uint32_t capacity);
+void edge_list_reset(edge_list_t *list);
+void edge_list_append(edge_list_t *list, const uint32_t *buffer, uint32_t word_count);
+// Appends every stride-th word, used for one channel of a de-interleaved capture
+void edge_list_append_strided(edge_list_t *list, const uint32_t *buffer, uint32_t word_count, uint32_t stride);
+void edge_list_finish(edge_list_t *list);
+void edge_list_build(edge_list_t *list, const uint32_t *buffer, uint32_t word_count);
+// Appends the runs of a run-length capture (sampler_rle in sampler.pio), lengths
+// in state machine cycles; runs the program had to split are joined again
+void edge_list_append_rle(edge_list_t *list, const uint32_t *words, uint32_t word_count);
+// Statistics threshold, kept across edge_list_reset
+void edge_list_set_glitch_threshold(edge_list_t *list, uint32_t samples);
+// Index of the run holding the given sample, list->count if it is beyond the stored runs
+uint32_t edge_list_run_at(const edge_list_t *list, uint32_t sample);
+
+// Min/max pyramid over the raw samples of one channel for the zoomed view.
+// A level 0 bucket is one 32-sample word, every further level halves the
+// resolution. Each level keeps three bit planes, one bit per bucket: some
+// sample is high, some sample is low, some sample differs from the one
+// before it.
+#define PYRAMID_MAX_LEVELS 16
+#define PYRAMID_BUCKET_SHIFT 5 // log2 samples of a level 0 bucket
+// storage for word_count words: the planes of all levels add up to less than twice those of level 0
+#define PYRAMID_STORAGE_WORDS(word_count) (6 * (((word_count) + 31) / 32) + 3 * PYRAMID_MAX_LEVELS)
+
+// Flags of a bucket or display column
+#define PYRAMID_HIGH 0x01
+#define PYRAMID_LOW  0x02
+#define PYRAMID_EDGE 0x04
+
+typedef struct {
+    uint32_t *storage;
+    uint32_t capacity;      // words of storage
+    uint32_t levels;        // levels built, 0 without samples
+    uint32_t total_samples;
+    uint32_t last;          // last sample appended, the edge plane compares with it
+    uint32_t buckets[PYRAMID_MAX_LEVELS];
+    uint32_t plane_words[PYRAMID_MAX_LEVELS]; // distance between the planes of a level
+    uint32_t *planes[PYRAMID_MAX_LEVELS]; // high, low and edge planes of a level, one after the other
+} pyramid_t;
+
+// Like the edge list: bind storage, then either build it from a whole buffer
+// or reset / append blocks / finish it. Appending fills level 0 only, words
+// beyond what the storage holds for it are dropped; finish builds the levels
+// above, those that do not fit the storage are left out.
+void pyramid_init(pyramid_t *pyramid, uint32_t *storage, uint32_t capacity);
+void pyramid_reset(pyramid_t *pyramid);
+// Appends every stride-th word in one pass over the words
+void pyramid_append(pyramid_t *pyramid, const uint32_t *buffer, uint32_t word_count, uint32_t stride);
+void pyramid_finish(pyramid_t *pyramid);
+void pyramid_build(pyramid_t *pyramid, const uint32_t *buffer, uint32_t word_count, uint32_t stride);
+// Flags of one bucket, 0 beyond the end
+uint8_t pyramid_bucket(const pyramid_t *pyramid, uint32_t level, uint32_t index);
+// Flags of `count` display columns of 2^zoom samples each from sample `start`
+// on. Down to one bucket per column the pyramid is read, one lookup per
+// column; finer columns come from the runs of the list, which also stand in
+// for a missing pyramid (run-length captures). 0 beyond the end.
+void render_columns(const pyramid_t *pyramid, const edge_list_t *list, uint32_t start, uint32_t zoom,
+                    uint8_t *columns, uint32_t count);
+
+// In-place de-interleave of a multi-channel capture (1, 2, 4 or 8 channels):
+// afterwards word g * channel_count + c holds 32 samples of channel c, so
+// channel c is buffer + c with a stride of channel_count words
+void deinterleave_channels(uint32_t *buffer, uint32_t word_count, uint8_t channel_count);
+
+// Same result as analyze_signal_buffer, computed from the edge list totals
+analysis_result_t analyze_edge_list(const edge_list_t *list, uint32_t sample_rate);
+
+// Detect whether the capture contains any transitions (activity)
+bool detect_signal_activity(const edge_list_t *list);
+
+// Early stop of a capture appended block by block: the frequency
+// (transitions per sample) and the duty cycle of every new block on its own
+// are compared with those over all samples so far, allowing for a transition
+// or a pulse cut at the block ends. Ending part way into a period puts the
+// running estimate over S samples off by up to period / S, so the stop also
+// waits until that is within the tolerances (the period taken as the longest
+// high plus the longest low run). Once agree_blocks blocks in a row agree,
+// more blocks would not change the result; a signal whose blocks keep
+// differing, or whose period is too long for the buffer, runs to the end.
+// The firmware's settings, the host bench checks them:
+#define CONVERGE_MIN_TRANSITIONS 32
+#define CONVERGE_AGREE_BLOCKS 2
+#define CONVERGE_TOLERANCE_PPM 1000
+#define CONVERGE_DUTY_TOLERANCE_BP 10
+
+typedef struct {
+    uint32_t min_transitions;   // no decision on fewer
+    uint32_t agree_blocks;      // consecutive blocks that have to agree
+    uint32_t tolerance_ppm;     // frequency difference that counts as agreeing
+    uint32_t duty_tolerance_bp; // duty cycle difference that counts as agreeing
+    uint32_t transitions;       // at the previous update
+    uint32_t total_samples;
+    uint32_t high_count;
+    uint32_t agreed;            // blocks in a row that agreed
+    uint32_t blocks;            // updates since the reset
+} convergence_t;
 
-// Analyze buffer and return populated result
-analysis_result_t analyze_signal_buffer(const uint32_t *buffer, uint32_t word_count, double sample_rate);
+void convergence_reset(convergence_t *conv);
+// Call after appending a block to the list, true once the capture can stop
+bool convergence_update(convergence_t *conv, const edge_list_t *list);
 
-// Detect whether buffer contains any transitions (activity)
-bool detect_signal_activity(const uint32_t *buffer, uint32_t word_count);
+// Mean and standard deviation in samples, 24.8 fixed point, 0 without any run
+uint32_t run_stats_mean_q8(const run_stats_t *stats);
+uint32_t run_stats_stddev_q8(const run_stats_t *stats);
 
-// Calculate duty cycle (percentage of HIGH samples) from the raw buffer
-float calculate_duty_cycle(const uint32_t *buffer, uint32_t word_count);
+// Calculate duty cycle (share of HIGH samples) in basis points
+uint32_t calculate_duty_cycle(const edge_list_t *list);
 
-void reduce_buffer_to_32(const uint32_t *buffer, uint32_t word_count, reduce_t out[32], uint32_t avg_fullpulse_width);
+// Reduce the captured runs from first_run on to a display pattern, spikes shorter than avg_fullpulse_width / 2 become reduced_pin
+void reduce_edges_to_32(const edge_list_t *list, uint32_t first_run, reduce_t out[128], uint32_t avg_fullpulse_width);
 
 #endif // ANALYZER_H
@@ -1,49 +1,124 @@
 #include "button.h"
+#include <hardware/gpio.h>
+#include <hardware/sync.h>
 
-void button_init(Button* btn, uint8_t pin) {
-    btn->pin = pin;
-    btn->state = false;
-    btn->hold = false;
-    btn->click_flag = false;
-    btn->hold_flag = false;
-    btn->timer = 0;
+// Кнопки, между которыми делится обработчик прерываний GPIO
+#define BUTTON_MAX 8
 
-    gpio_init(pin);
-    gpio_set_dir(pin, GPIO_IN);
-    gpio_pull_up(pin);  // кнопка подключена к GND
-}
+static Button *buttons[BUTTON_MAX];
+static uint button_count = 0;
 
-void button_tick(Button* btn) {
-    bool level = gpio_get(btn->pin);
-    bool state = !level;  // активный уровень — LOW
+static uint8_t pressed_mask(void) {
+    uint8_t mask = 0;
+    for (uint i = 0; i < button_count; i++) {
+        if (buttons[i]->state) mask |= 1u << i;
+    }
+    return mask;
+}
 
-    btn->click_flag = false;
-    btn->hold_flag = false;
+static void queue_push(button_queue_t *queue, uint8_t pin, uint8_t type, uint64_t time) {
+    uint32_t head = queue->head;
+    if (head - queue->tail >= BUTTON_QUEUE_SIZE) {
+        queue->dropped++;
+        return;
+    }
+    button_event_t *event = &queue->events[head & (BUTTON_QUEUE_SIZE - 1)];
+    event->pin = pin;
+    event->type = type;
+    event->pressed = pressed_mask();
+    event->time = time;
+    // событие записано раньше, чем другое ядро увидит новый head
+    __dmb();
+    queue->head = head + 1;
+}
 
-    uint64_t now = time_us_64();
+void button_queue_init(button_queue_t *queue) {
+    queue->head = 0;
+    queue->tail = 0;
+    queue->dropped = 0;
+}
 
-    // Антидребезг: проверка изменения состояния
-    if (btn->state != state && (now - btn->timer) >= BTN_DEB * 1000ULL) {
-        btn->state = state;
-        btn->timer = now;
+bool button_queue_pop(button_queue_t *queue, button_event_t *event) {
+    uint32_t tail = queue->tail;
+    if (tail == queue->head) return false;
+    __dmb();
+    *event = queue->events[tail & (BUTTON_QUEUE_SIZE - 1)];
+    // слот освобождается только после чтения
+    __dmb();
+    queue->tail = tail + 1;
+    return true;
+}
 
-        if (state) {
-            btn->click_flag = true;  // клик при нажатии
-        }
-        btn->hold = false;  // сброс удержания при новом нажатии
+// Первое срабатывание — удержание, дальше автоповтор с шагом от срока,
+// а не от момента вызова
+static int64_t hold_alarm(alarm_id_t id, void *user_data) {
+    Button *btn = user_data;
+    if (!btn->state) {
+        btn->hold_alarm = 0;
+        return 0;
     }
+    queue_push(btn->queue, btn->pin, btn->repeat ? BUTTON_REPEAT : BUTTON_HOLD, time_us_64());
+    btn->repeat = true;
+    return -(int64_t)BTN_REPEAT * 1000;
+}
+
+static int64_t debounce_alarm(alarm_id_t id, void *user_data);
 
-    // Проверка удержания
-    if (btn->state && !btn->hold && (now - btn->timer) >= BTN_HOLD * 1000ULL) {
-        btn->hold = true;
-        btn->hold_flag = true;
+// Новое стабильное состояние: событие сразу по первому фронту, затем
+// BTN_DEB фронты не смотрим
+static void button_change(Button *btn, bool state, uint64_t now) {
+    btn->state = state;
+    btn->timer = now;
+
+    if (btn->hold_alarm) {
+        cancel_alarm(btn->hold_alarm);
+        btn->hold_alarm = 0;
+    }
+    if (state) {
+        btn->repeat = false;
+        queue_push(btn->queue, btn->pin, BUTTON_CLICK, now);
+        alarm_id_t id = add_alarm_in_ms(BTN_HOLD, hold_alarm, btn, true);
+        btn->hold_alarm = id > 0 ? id : 0;
+    } else if (!btn->repeat) {
+        // удержания не было
+        queue_push(btn->queue, btn->pin, BUTTON_SHORT, now);
     }
+
+    btn->debouncing = add_alarm_in_ms(BTN_DEB, debounce_alarm, btn, true) > 0;
+}
+
+// Конец выдержки: за время дребезга кнопку могли отпустить или нажать снова
+static int64_t debounce_alarm(alarm_id_t id, void *user_data) {
+    Button *btn = user_data;
+    btn->debouncing = false;
+    bool state = !gpio_get(btn->pin);  // активный уровень — LOW
+    if (state != btn->state) button_change(btn, state, time_us_64());
+    return 0;
 }
 
-bool button_click(Button* btn) {
-    return btn->click_flag;
+static void button_gpio_irq(uint gpio, uint32_t events) {
+    for (uint i = 0; i < button_count; i++) {
+        Button *btn = buttons[i];
+        if (btn->pin != gpio || btn->debouncing) continue;
+        bool state = !gpio_get(gpio);
+        if (state != btn->state) button_change(btn, state, time_us_64());
+    }
 }
 
-bool button_hold(Button* btn) {
-    return btn->hold_flag;
-}
\ No newline at end of file
+void button_init(Button* btn, uint8_t pin, button_queue_t *queue) {
+    btn->pin = pin;
+    btn->index = button_count;
+    btn->state = false;
+    btn->debouncing = false;
+    btn->repeat = false;
+    btn->hold_alarm = 0;
+    btn->timer = 0;
+    btn->queue = queue;
+
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_pull_up(pin);  // кнопка подключена к GND
+
+    if (button_count < BUTTON_MAX) buttons[button_count++] = btn;
+    gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, button_gpio_irq);
+}
@@ -6,27 +6,57 @@
 #include "pico/stdlib.h"
 
 // Таймауты в миллисекундах
-#define BTN_DEB   50   // антидребезг
-#define BTN_HOLD  700  // удержание
+#define BTN_DEB     50   // антидребезг
+#define BTN_HOLD    700  // удержание
+#define BTN_REPEAT  250  // автоповтор, пока кнопка удерживается
 
-// Структура кнопки
+// Типы событий
+typedef enum {
+    BUTTON_CLICK = 0,   // нажатие
+    BUTTON_HOLD,        // удержание дольше BTN_HOLD
+    BUTTON_REPEAT,      // после удержания каждые BTN_REPEAT
+    BUTTON_SHORT        // отпускание раньше BTN_HOLD: короткое нажатие без удержания
+} button_event_type_t;
+
+// Событие кнопки
+typedef struct {
+    uint8_t pin;
+    uint8_t type;       // button_event_type_t
+    uint8_t pressed;    // нажатые кнопки в момент события, бит на кнопку в порядке button_init
+    uint64_t time;      // время события (в микросекундах)
+} button_event_t;
+
+// Размер очереди, степень двойки
+#define BUTTON_QUEUE_SIZE 16
+
+// Очередь событий без блокировок: пишут только прерывания ядра 0,
+// читает один потребитель на любом ядре
+typedef struct {
+    button_event_t events[BUTTON_QUEUE_SIZE];
+    volatile uint32_t head;     // записано событий, счётчик без сброса
+    volatile uint32_t tail;     // прочитано событий
+    volatile uint32_t dropped;  // потеряно из-за переполнения
+} button_queue_t;
+
+// Структура кнопки, состояние меняют прерывания
 typedef struct {
     uint8_t pin;
-    bool state;         // текущее стабильное состояние (true = нажата)
-    bool hold;          // флаг: было ли удержание
-    bool click_flag;    // флаг: произошёл клик
-    bool hold_flag;     // флаг: произошло удержание
-    uint64_t timer;     // время последнего изменения (в микросекундах)
+    uint8_t index;              // номер бита в button_event_t.pressed
+    volatile bool state;        // текущее стабильное состояние (true = нажата)
+    volatile bool debouncing;   // идёт выдержка антидребезга, фронты не смотрим
+    bool repeat;                // удержание уже было, дальше автоповтор
+    alarm_id_t hold_alarm;      // будильник удержания, 0 если не заведён
+    uint64_t timer;             // время последнего изменения (в микросекундах)
+    button_queue_t *queue;
 } Button;
 
-// Инициализация кнопки
-void button_init(Button* btn, uint8_t pin);
+void button_queue_init(button_queue_t *queue);
 
-// Вызывать часто (в цикле)
-void button_tick(Button* btn);
+// Инициализация кнопки: прерывание по обоим фронтам, события идут в queue.
+// Вызывать на ядре 0, структура должна жить всё время работы.
+void button_init(Button* btn, uint8_t pin, button_queue_t *queue);
 
-// Проверка событий (флаги сбрасываются в button_tick)
-bool button_click(Button* btn);
-bool button_hold(Button* btn);
+// Забирает самое старое событие, false если очередь пуста
+bool button_queue_pop(button_queue_t *queue, button_event_t *event);
 
-#endif
\ No newline at end of file
+#endif
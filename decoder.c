@@ -0,0 +1,266 @@
+#include "decoder.h"
+
+// Position in an edge list, moved forward only
+typedef struct {
+    const edge_list_t *list;
+    uint32_t index;         // current run
+    uint32_t start;         // first sample of the current run
+} run_cursor_t;
+
+static void cursor_init(run_cursor_t *cursor, const edge_list_t *list) {
+    cursor->list = list;
+    cursor->index = 0;
+    cursor->start = 0;
+}
+
+static inline bool cursor_valid(const run_cursor_t *cursor) {
+    return cursor->index < cursor->list->count;
+}
+
+static inline uint32_t cursor_end(const run_cursor_t *cursor) {
+    return cursor->start + cursor->list->runs[cursor->index].length;
+}
+
+static inline void cursor_next(run_cursor_t *cursor) {
+    cursor->start = cursor_end(cursor);
+    cursor->index++;
+}
+
+// Level at sample t, t must not go back between calls and must lie within the
+// stored runs: past the last one the level is not known.
+static inline uint32_t cursor_level_at(run_cursor_t *cursor, uint32_t t) {
+    while (cursor->index + 1 < cursor->list->count && cursor_end(cursor) <= t) {
+        cursor_next(cursor);
+    }
+    return cursor->list->runs[cursor->index].level;
+}
+
+// Whether the level is high anywhere from the current run of the cursor to the
+// one holding sample t; moves the cursor there like cursor_level_at.
+static inline bool cursor_high_until(run_cursor_t *cursor, uint32_t t) {
+    bool high = cursor->list->runs[cursor->index].level;
+    while (cursor->index + 1 < cursor->list->count && cursor_end(cursor) <= t) {
+        cursor_next(cursor);
+        high |= cursor->list->runs[cursor->index].level;
+    }
+    return high;
+}
+
+void decode_ring_push(decode_ring_t *ring, uint32_t sample, uint8_t value, uint8_t flags) {
+    decoded_frame_t *frame = &ring->frames[ring->head & (DECODE_RING_SIZE - 1)];
+    frame->sample = sample;
+    frame->value = value;
+    frame->flags = flags;
+    ring->head++;
+}
+
+const decoded_frame_t *decode_ring_get(const decode_ring_t *ring, uint32_t age) {
+    return &ring->frames[(ring->head - 1 - age) & (DECODE_RING_SIZE - 1)];
+}
+
+// The shortest pulse is one bit or a little less, every run is then close to
+// a whole number of bits; the bit time is the total length of the runs over
+// their total number of bits. The partial first and last runs are left out.
+uint32_t uart_auto_baud(const edge_list_t *list, uint32_t min_pulse) {
+    uint32_t shortest = UINT32_MAX;
+    for (uint32_t i = 1; i + 1 < list->count; i++) {
+        uint32_t length = list->runs[i].length;
+        if (length >= min_pulse && length < shortest) shortest = length;
+    }
+    if (shortest == UINT32_MAX) return 0;
+
+    uint64_t samples = 0;
+    uint32_t bits = 0;
+    for (uint32_t i = 1; i + 1 < list->count; i++) {
+        uint32_t length = list->runs[i].length;
+        if (length < min_pulse) continue;
+        uint32_t n = (length + shortest / 2) / shortest;
+        // idle gaps say nothing about the bit time
+        if (n > 10) continue;
+        samples += length;
+        bits += n;
+    }
+    return bits ? (uint32_t)((samples << 8) / bits) : 0;
+}
+
+// A start bit begins on every falling edge that is not inside a frame. The
+// bits are sampled in their middle, 1.5 bit times after the start edge and
+// then one bit time apart.
+static uint32_t decode_uart(decoder_t *decoder, decode_ring_t *ring) {
+    const edge_list_t *list = decoder->clock;
+    uint32_t frames = 0;
+
+    decoder->bit_q8 = uart_auto_baud(list, decoder->min_pulse);
+    uint32_t bit_q8 = decoder->bit_q8;
+    if (bit_q8 == 0) return 0;
+
+    run_cursor_t edge, sample;
+    cursor_init(&edge, list);
+    cursor_init(&sample, list);
+    uint32_t busy_until = 0; // end of the last frame
+
+    // the first run has no edge at its start
+    for (cursor_next(&edge); cursor_valid(&edge); cursor_next(&edge)) {
+        if (list->runs[edge.index].level != 0 || edge.start < busy_until) continue;
+
+        uint64_t start_q8 = (uint64_t)edge.start << 8;
+        uint32_t stop = (start_q8 + (uint64_t)bit_q8 * 9 + bit_q8 / 2) >> 8;
+        if (stop >= decoder->end) break;
+
+        uint8_t value = 0;
+        for (uint32_t b = 0; b < 8; b++) {
+            uint32_t t = (start_q8 + (uint64_t)bit_q8 * (b + 1) + bit_q8 / 2) >> 8;
+            value |= cursor_level_at(&sample, t) << b;
+        }
+        uint8_t flags = cursor_level_at(&sample, stop) ? 0 : DECODE_FLAG_ERROR;
+
+        decode_ring_push(ring, edge.start, value, flags);
+        frames++;
+        busy_until = stop;
+    }
+    return frames;
+}
+
+// Bits are taken on the sampling edge of the clock. With a chip select the
+// byte restarts whenever it goes high, without one whenever the clock has
+// been idle for longer than four of its shortest periods.
+static uint32_t decode_spi(decoder_t *decoder, decode_ring_t *ring) {
+    const edge_list_t *clock = decoder->clock;
+    uint32_t sample_level = decoder->cpol ^ decoder->cpha ? 0 : 1; // clock level after the sampling edge
+    uint32_t gap = clock->stats.period.count ? clock->stats.period.min * 4 : UINT32_MAX;
+    uint32_t frames = 0;
+
+    run_cursor_t edge, data, select;
+    cursor_init(&edge, clock);
+    cursor_init(&data, decoder->data);
+    if (decoder->select) cursor_init(&select, decoder->select);
+
+    uint8_t value = 0;
+    uint32_t bits = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+
+    for (cursor_next(&edge); cursor_valid(&edge); cursor_next(&edge)) {
+        if (clock->runs[edge.index].level != sample_level) continue;
+        uint32_t t = edge.start;
+        if (t >= decoder->end) break;
+
+        // a chip select high at any point since the last sampling edge ends the
+        // byte; the clock does not run while it is high, so checking at t would
+        // leave a byte cut at the start of the capture misaligned
+        bool reset = decoder->select ? cursor_high_until(&select, t) : (bits > 0 && t - last > gap);
+        last = t;
+        if (reset) {
+            bits = 0;
+            if (decoder->select && select.list->runs[select.index].level) continue;
+        }
+
+        if (bits == 0) {
+            first = t;
+            value = 0;
+        }
+        value = (value << 1) | cursor_level_at(&data, t);
+        if (++bits == 8) {
+            decode_ring_push(ring, first, value, 0);
+            frames++;
+            bits = 0;
+        }
+    }
+    return frames;
+}
+
+// SCL and SDA edges are merged in time order. SDA changing while SCL is high
+// is a START (falling) or STOP (rising), otherwise SDA is read on every
+// rising edge of SCL: 8 data bits, then the acknowledge bit.
+static uint32_t decode_i2c(decoder_t *decoder, decode_ring_t *ring) {
+    const edge_list_t *scl_list = decoder->clock;
+    const edge_list_t *sda_list = decoder->data;
+    uint32_t frames = 0;
+
+    run_cursor_t scl, sda;
+    cursor_init(&scl, scl_list);
+    cursor_init(&sda, sda_list);
+    if (!cursor_valid(&scl) || !cursor_valid(&sda)) return 0;
+
+    uint32_t scl_level = scl_list->runs[0].level;
+    uint32_t sda_level = sda_list->runs[0].level;
+    bool in_frame = false;
+    bool address = false;
+    uint32_t bits = 0;
+    uint32_t value = 0;
+    uint32_t first = 0;
+
+    while (true) {
+        bool scl_next = scl.index + 1 < scl_list->count && cursor_end(&scl) < decoder->end;
+        bool sda_next = sda.index + 1 < sda_list->count && cursor_end(&sda) < decoder->end;
+        if (!scl_next && !sda_next) break;
+        // on a tie SCL goes first: data set up on the falling clock edge is not a START / STOP
+        if (scl_next && (!sda_next || cursor_end(&scl) <= cursor_end(&sda))) {
+            cursor_next(&scl);
+            scl_level = scl_list->runs[scl.index].level;
+            if (!scl_level || !in_frame) continue;
+
+            if (bits == 0) {
+                first = scl.start;
+                value = 0;
+            }
+            if (bits < 8) {
+                value = (value << 1) | sda_level;
+                bits++;
+            } else {
+                decode_ring_push(ring, first, value, (address ? DECODE_FLAG_START : 0) | (sda_level ? DECODE_FLAG_NACK : 0));
+                frames++;
+                address = false;
+                bits = 0;
+            }
+        } else {
+            cursor_next(&sda);
+            sda_level = sda_list->runs[sda.index].level;
+            if (!scl_level) continue;
+
+            // the clock pulse ahead of a START / STOP reads one bit, more are a cut byte
+            if (in_frame && bits > 1) {
+                decode_ring_push(ring, first, value, DECODE_FLAG_ERROR);
+                frames++;
+            }
+            bits = 0;
+            if (sda_level) {
+                decode_ring_push(ring, sda.start, 0, DECODE_FLAG_STOP);
+                frames++;
+                in_frame = false;
+            } else {
+                in_frame = true;
+                address = true;
+            }
+        }
+    }
+    return frames;
+}
+
+uint32_t decode_capture(decoder_t *decoder, decode_ring_t *ring) {
+    decoder->end = 0;
+    decoder->truncated = false;
+    // run-length captures leave the other channels empty
+    if (!decoder->clock || decoder->clock->count == 0) return 0;
+    if (decoder->protocol != DECODE_UART && (!decoder->data || decoder->data->count == 0)) return 0;
+    if (decoder->select && decoder->select->count == 0) return 0;
+
+    // SPI and I2C lists may have run out of room at different points
+    decoder->end = decoder->clock->stored_samples;
+    if (decoder->protocol != DECODE_UART) {
+        uint32_t data_end = decoder->data->stored_samples;
+        if (data_end < decoder->end) decoder->end = data_end;
+        if (decoder->select) {
+            uint32_t select_end = decoder->select->stored_samples;
+            if (select_end < decoder->end) decoder->end = select_end;
+        }
+    }
+    decoder->truncated = decoder->end < decoder->clock->total_samples;
+
+    switch (decoder->protocol) {
+        case DECODE_UART: return decode_uart(decoder, ring);
+        case DECODE_SPI: return decode_spi(decoder, ring);
+        case DECODE_I2C: return decode_i2c(decoder, ring);
+        default: return 0;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "analyzer.h"
+
+// Serial protocol decoders over the edge lists of a capture. They step from
+// edge to edge and look up the other channels with cursors that only move
+// forward, so the time taken grows with the number of edges, not samples.
+
+typedef enum {
+    DECODE_NONE = 0,
+    DECODE_UART,    // 8N1, idle high, LSB first, bit time from the shortest pulses
+    DECODE_SPI,     // 8 bits MSB first on the sampling edge of the clock
+    DECODE_I2C
+} decode_protocol_t;
+
+#define DECODE_FLAG_ERROR   0x01 // UART: stop bit low, I2C: byte cut by START / STOP
+#define DECODE_FLAG_START   0x02 // I2C address byte, first byte after (repeated) START
+#define DECODE_FLAG_NACK    0x04 // I2C: no acknowledge
+#define DECODE_FLAG_STOP    0x08 // I2C STOP condition, no data
+
+typedef struct {
+    uint32_t sample;    // first sample of the frame in the capture
+    uint8_t value;
+    uint8_t flags;
+} decoded_frame_t;
+
+// Must be a power of 2
+#define DECODE_RING_SIZE 64
+
+// Decoded frames of the latest captures, the oldest are overwritten
+typedef struct {
+    decoded_frame_t frames[DECODE_RING_SIZE];
+    uint32_t head;          // frames written, free running
+} decode_ring_t;
+
+typedef struct {
+    decode_protocol_t protocol;
+    // channel lists: UART data / SPI clock / I2C SCL
+    const edge_list_t *clock;
+    // SPI data (MOSI or MISO) / I2C SDA
+    const edge_list_t *data;
+    // SPI chip select, active low, NULL to frame bytes by gaps in the clock
+    const edge_list_t *select;
+    bool cpol;              // SPI clock idle level
+    bool cpha;              // SPI: sample on the second clock edge
+    uint32_t min_pulse;     // UART: pulses shorter than this are ignored for the bit time
+    uint32_t bit_q8;        // UART result: bit time in samples, 24.8 fixed point
+    uint32_t end;           // result: sample the decode stopped at, where the first of its lists runs out of stored runs
+    bool truncated;         // result: that was before the end of the capture, later frames are lost
+} decoder_t;
+
+void decode_ring_push(decode_ring_t *ring, uint32_t sample, uint8_t value, uint8_t flags);
+// Frame `age` entries before the newest one (0 = newest)
+const decoded_frame_t *decode_ring_get(const decode_ring_t *ring, uint32_t age);
+
+// Decodes the stored runs of the capture into the ring, returns the number of
+// frames. A truncated list covers only the start of the capture, so decoding
+// stops at the end of the shortest stored list and sets `truncated`.
+uint32_t decode_capture(decoder_t *decoder, decode_ring_t *ring);
+
+// Bit time in samples (24.8) from the shortest pulses of a UART line, 0 without edges
+uint32_t uart_auto_baud(const edge_list_t *list, uint32_t min_pulse);
+
+#endif // !DECODER_H
@@ -0,0 +1,111 @@
+#include "edgecounter.h"
+
+#include "units.h"
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/pwm.h>
+#include <hardware/sync.h>
+#include <pico/stdlib.h>
+
+#define EDGE_COUNTER_DMA_COUNT 0xFFFFFFFFu
+// counter values this close after a wrap may not have been seen by the DMA yet
+#define EDGE_COUNTER_WRAP_SETTLE 32
+
+// Total edges so far. Counter and wrap count are read until they agree; right
+// after a wrap the DMA needs a few cycles, which the settle wait covers.
+static uint64_t edge_counter_read(edge_counter_t *ec) {
+    dma_channel_hw_t *hw = dma_channel_hw_addr(ec->dma_channel);
+    uint32_t count, counter;
+    for (int settle = 0; ; settle++) {
+        do {
+            count = hw->transfer_count;
+            counter = pwm_get_counter(ec->slice);
+        } while (count != hw->transfer_count);
+        if (counter >= EDGE_COUNTER_WRAP_SETTLE || settle) break;
+        busy_wait_us_32(1);
+    }
+    uint64_t wraps = ec->wrap_base + (EDGE_COUNTER_DMA_COUNT - count);
+    return (wraps << 16) + counter;
+}
+
+// Alarm at the end of a gate: the next gate opens at the same reading
+static bool edge_counter_alarm(repeating_timer_t *timer) {
+    edge_counter_t *ec = timer->user_data;
+    uint64_t edges = edge_counter_read(ec);
+    uint64_t now = time_us_64();
+
+    ec->gate_edges = (uint32_t)(edges - ec->open_edges);
+    ec->gate_us = (uint32_t)(now - ec->open_time_us);
+    ec->gates++;
+    ec->open_edges = edges;
+    ec->open_time_us = now;
+
+    // the wrap count runs down from 2^32, restart it long before it stops (2^47 edges);
+    // a wrap during the restart itself would be lost
+    dma_channel_hw_t *hw = dma_channel_hw_addr(ec->dma_channel);
+    if (hw->transfer_count < EDGE_COUNTER_DMA_COUNT / 2) {
+        dma_channel_abort(ec->dma_channel);
+        ec->wrap_base += EDGE_COUNTER_DMA_COUNT - hw->transfer_count;
+        dma_channel_set_trans_count(ec->dma_channel, EDGE_COUNTER_DMA_COUNT, true);
+    }
+    return true;
+}
+
+void setup_edge_counter(edge_counter_t *ec) {
+    ec->slice = pwm_gpio_to_slice_num(ec->pin);
+    gpio_set_function(ec->pin, GPIO_FUNC_PWM);
+
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv_mode(&config, PWM_DIV_B_RISING);
+    pwm_config_set_clkdiv_int(&config, 1);
+    pwm_config_set_wrap(&config, 0xFFFF);
+    pwm_init(ec->slice, &config, false);
+
+    ec->dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config dma = dma_channel_get_default_config(ec->dma_channel);
+    channel_config_set_transfer_data_size(&dma, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma, false);
+    channel_config_set_write_increment(&dma, false);
+    channel_config_set_dreq(&dma, pwm_get_dreq(ec->slice));
+    dma_channel_configure(
+        ec->dma_channel,
+        &dma,
+        &ec->dma_dummy,
+        &ec->dma_dummy,
+        EDGE_COUNTER_DMA_COUNT,
+        true
+    );
+
+    ec->wrap_base = 0;
+    ec->gates = 0;
+    ec->polled_gates = 0;
+    pwm_set_enabled(ec->slice, true);
+    edge_counter_set_gate(ec, ec->gate_ms);
+}
+
+void edge_counter_set_gate(edge_counter_t *ec, uint32_t gate_ms) {
+    if (gate_ms < EDGE_COUNTER_MIN_GATE_MS) gate_ms = EDGE_COUNTER_MIN_GATE_MS;
+    if (gate_ms > EDGE_COUNTER_MAX_GATE_MS) gate_ms = EDGE_COUNTER_MAX_GATE_MS;
+    if (ec->timer.alarm_id) cancel_repeating_timer(&ec->timer);
+
+    ec->gate_ms = gate_ms;
+    ec->open_edges = edge_counter_read(ec);
+    ec->open_time_us = time_us_64();
+    ec->polled_gates = ec->gates;
+    // negative: every gate is timed from the scheduled start of the previous one
+    add_repeating_timer_ms(-(int32_t)gate_ms, edge_counter_alarm, ec, &ec->timer);
+}
+
+bool edge_counter_poll(edge_counter_t *ec, uint64_t *freq_mhz) {
+    uint32_t gates, edges, us;
+    do {
+        gates = ec->gates;
+        edges = ec->gate_edges;
+        us = ec->gate_us;
+    } while (gates != ec->gates);
+
+    if (gates == ec->polled_gates || us == 0) return false;
+    ec->polled_gates = gates;
+    *freq_mhz = scaled_div((uint64_t)edges * 1000000, 1000, us);
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef EDGECOUNTER_H
+#define EDGECOUNTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pico/time.h>
+
+#define EDGE_COUNTER_MIN_GATE_MS 10
+#define EDGE_COUNTER_MAX_GATE_MS 10000
+
+// Gated edge counter: a PWM slice counts the rising edges on its B input
+// (odd GPIOs only), a DMA channel paced by the slice wrapping counts the
+// overflows of its 16-bit counter. A repeating timer alarm reads both at the
+// end of every gate, so the count keeps going without gaps and without any
+// CPU time between the gates, whatever the cores are busy with. The
+// resolution is one edge per gate: 1 Hz at 1 s, 0.1 Hz at 10 s.
+typedef struct {
+    uint pin;
+    uint32_t gate_ms;
+    uint slice;
+    int dma_channel;
+    uint32_t dma_dummy;     // DMA source and destination, only its transfer count matters
+    repeating_timer_t timer;
+    uint64_t wrap_base;     // wraps counted before the last restart of the DMA channel
+    uint64_t open_edges;    // count and time the running gate opened at
+    uint64_t open_time_us;
+    // result of the last gate, written by the alarm
+    volatile uint32_t gate_edges;
+    volatile uint32_t gate_us;
+    volatile uint32_t gates; // gates closed, incremented after the result is written
+    uint32_t polled_gates;
+} edge_counter_t;
+
+void setup_edge_counter(edge_counter_t *ec);
+void edge_counter_set_gate(edge_counter_t *ec, uint32_t gate_ms);
+// Returns true and the frequency in milli-Hz when a gate has closed since the last call
+bool edge_counter_poll(edge_counter_t *ec, uint64_t *freq_mhz);
+
+#endif // !EDGECOUNTER_H
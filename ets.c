@@ -0,0 +1,85 @@
+#include "ets.h"
+#include <string.h>
+
+#include "units.h"
+
+// Column of an edge `residual` (16.16 samples) after the fitted position of
+// the rising edge of its period; the window starts 1/8 period ahead of it
+static inline uint32_t ets_column(int64_t residual, int64_t period) {
+    int64_t phase = (residual + period / 8) % period;
+    if (phase < 0) phase += period;
+    return (uint32_t)(phase * ETS_COLUMNS / period);
+}
+
+// Rising edge k of the stored runs is t_k; the least squares line
+// t_k = a + k * P gives P = 6 * sum((2k - (n - 1)) * t_k) / (n * (n^2 - 1))
+// and a = mean(t) - P * (n - 1) / 2. Every edge is then taken relative to the
+// line at the rising edge opening its period. A sample stands for the time
+// since the one before it, so the edges seen are on average half a sample late.
+uint32_t ets_fold(ets_t *ets, const edge_list_t *list) {
+    ets->periods = 0;
+
+    uint64_t n = 0;
+    uint64_t sum_t = 0;
+    uint64_t sum_kt = 0;
+    uint32_t last_rise = 0;
+    uint32_t start = list->count ? list->runs[0].length : 0;
+    for (uint32_t i = 1; i < list->count && n <= ETS_MAX_PERIODS; start += list->runs[i++].length) {
+        if (!list->runs[i].level) continue;
+        sum_t += start;
+        sum_kt += n * start;
+        n++;
+        last_rise = i;
+    }
+    if (n < ETS_MIN_PERIODS + 1) return 0;
+
+    uint64_t s = 2 * sum_kt - (n - 1) * sum_t;
+    int64_t period = (int64_t)scaled_div(s, 6 * 65536, n * (n * n - 1));
+    int64_t a = (int64_t)((sum_t << 16) / n) - period * (int64_t)(n - 1) / 2;
+    if (period == 0) return 0;
+
+    memset(ets->work, 0, sizeof(ets->work));
+    int64_t k = -1;
+    uint64_t sum_high = 0;
+    uint32_t highs = 0;
+    bool fall_seen = true;
+    start = list->runs[0].length;
+    for (uint32_t i = 1; i < last_rise; start += list->runs[i++].length) {
+        uint32_t level = list->runs[i].level;
+        if (level) {
+            k++;
+            fall_seen = false;
+        }
+        if (k < 0) continue;
+        int64_t residual = ((int64_t)start << 16) - (a + k * period);
+        ets->work[ets_column(residual, period)] += level ? 1 : -1;
+        if (!level && !fall_seen) {
+            // the first falling edge closes the high time, later ones are glitches
+            sum_high += residual > 0 ? residual : 0;
+            highs++;
+            fall_seen = true;
+        }
+    }
+
+    uint32_t periods = (uint32_t)n - 1;
+    int32_t count = 0;
+    int32_t min = 0;
+    for (uint32_t c = 0; c < ETS_COLUMNS; c++) {
+        count += ets->work[c];
+        if (count < min) min = count;
+    }
+    // the edges say how the count changes, the column low in every period sets its base
+    count = -min;
+    for (uint32_t c = 0; c < ETS_COLUMNS; c++) {
+        count += ets->work[c];
+        uint32_t high = count < 0 ? 0 : (uint32_t)count > periods ? periods : (uint32_t)count;
+        ets->high[c] = (uint16_t)((uint64_t)high * 65535 / periods);
+    }
+
+    ets->period_q16 = (uint64_t)period;
+    ets->rise_q16 = a > 32768 ? (uint64_t)(a - 32768) : 0;
+    ets->high_q16 = highs ? sum_high / highs : 0;
+    ets->duty_bp = (uint32_t)scaled_div(ets->high_q16, 10000, ets->period_q16);
+    ets->periods = periods;
+    return periods;
+}
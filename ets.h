@@ -0,0 +1,38 @@
+#ifndef ETS_H
+#define ETS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "analyzer.h"
+
+// Equivalent-time view of a repetitive signal: the period is fitted to the
+// rising edges with sub-sample precision and every edge is folded modulo that
+// period. A period that is not a whole number of samples lands each edge at
+// a different phase of the sample clock, so the folded edges fill in the
+// waveform between the samples and their means place the edges well within
+// a sample. Nothing is gained on a signal locked to the sample clock.
+
+#define ETS_COLUMNS 128
+// periods folded at most, keeps the least squares sums within 64 bits
+#define ETS_MAX_PERIODS 4096
+// fewer periods give no useful fit
+#define ETS_MIN_PERIODS 8
+
+typedef struct {
+    uint16_t high[ETS_COLUMNS]; // share of the periods high at the phase of the column, 0.16 fixed point;
+                                // an edge spreads over the sample it fell in and sits where the share
+                                // crosses one half, the rising edge 1/8 of the period in
+    uint64_t period_q16;        // samples, 48.16 fixed point
+    uint64_t rise_q16;          // first rising edge of the capture, samples from its start
+    uint64_t high_q16;          // high time per period, from each rising edge to the falling edge after it
+    uint32_t duty_bp;
+    uint32_t periods;           // folded from the last capture, 0 if there were too few
+    int32_t work[ETS_COLUMNS];  // edges per column: rising +1, falling -1
+} ets_t;
+
+// Folds the complete periods among the stored runs of the list, returns the
+// number folded; with fewer than ETS_MIN_PERIODS nothing is folded and periods
+// becomes 0, which marks the rest of the view as stale.
+uint32_t ets_fold(ets_t *ets, const edge_list_t *list);
+
+#endif // !ETS_H
@@ -0,0 +1,93 @@
+#include "eye.h"
+#include <string.h>
+
+void eye_init(eye_t *eye, uint32_t decay_shift) {
+    eye->decay_shift = decay_shift;
+    eye_reset(eye);
+}
+
+void eye_reset(eye_t *eye) {
+    memset(eye->high, 0, sizeof(eye->high));
+    memset(eye->edge, 0, sizeof(eye->edge));
+    eye->span = 0;
+    eye->pre = 0;
+    eye->captures = 0;
+    eye->periods = 0;
+}
+
+// Blends the share of one capture into the decayed one
+static inline uint16_t eye_blend(const eye_t *eye, uint16_t old, uint32_t share) {
+    if (eye->captures == 0) return share;
+    return old + (((int32_t)share - old) >> eye->decay_shift);
+}
+
+// Each rising edge opens a window from `pre` samples ahead of it over `span`
+// samples. The runs from the one holding the window start on tile the window,
+// so each run adds its level over its columns with one increment and one
+// decrement, and its start, if inside the window, one edge. The window start
+// only moves forward, so does the run holding it.
+uint32_t eye_accumulate(eye_t *eye, const edge_list_t *list) {
+    const run_stats_t *period = &list->stats.period;
+    eye->periods = 0;
+    if (period->count == 0 || list->count < 2) return 0;
+
+    uint32_t mean = (uint32_t)(period->sum / period->count);
+    uint32_t span = mean + mean / 2;
+    // a new timebase would smear the old captures over the new one
+    if (span > eye->span + eye->span / 8 || span < eye->span - eye->span / 8) {
+        eye_reset(eye);
+        eye->span = span;
+        eye->pre = span / 6;
+    }
+    span = eye->span;
+    uint32_t pre = eye->pre;
+    // columns per sample, 32.32 fixed point
+    uint64_t scale = ((uint64_t)EYE_COLUMNS << 32) / span;
+
+    uint32_t stored = 0;
+    for (uint32_t i = 0; i < list->count; i++) stored += list->runs[i].length;
+
+    memset(eye->work_high, 0, sizeof(eye->work_high));
+    memset(eye->work_edge, 0, sizeof(eye->work_edge));
+
+    uint32_t periods = 0;
+    uint32_t from = 0;          // run holding the window start
+    uint32_t from_start = 0;
+    uint32_t start = list->runs[0].length;
+    for (uint32_t i = 1; i < list->count; start += list->runs[i++].length) {
+        if (!list->runs[i].level || start < pre) continue;
+        uint32_t w0 = start - pre;
+        uint32_t w1 = w0 + span;
+        if (w1 > stored) break;
+
+        while (from_start + list->runs[from].length <= w0) {
+            from_start += list->runs[from].length;
+            from++;
+        }
+        uint32_t k_start = from_start;
+        for (uint32_t k = from; k_start < w1; k_start += list->runs[k++].length) {
+            uint32_t end = k_start + list->runs[k].length;
+            uint32_t a = k_start > w0 ? k_start : w0;
+            uint32_t ca = (uint32_t)(((uint64_t)(a - w0) * scale) >> 32);
+            uint32_t cb = end >= w1 ? EYE_COLUMNS : (uint32_t)(((uint64_t)(end - w0) * scale) >> 32);
+            if (list->runs[k].level) {
+                eye->work_high[ca]++;
+                eye->work_high[cb]--;
+            }
+            if (k > 0 && k_start >= w0) eye->work_edge[ca]++;
+        }
+        periods++;
+    }
+    if (periods == 0) return 0;
+
+    int32_t high = 0;
+    for (uint32_t c = 0; c < EYE_COLUMNS; c++) {
+        high += eye->work_high[c];
+        uint32_t edges = eye->work_edge[c] < periods ? eye->work_edge[c] : periods;
+        eye->high[c] = eye_blend(eye, eye->high[c], (uint32_t)((uint64_t)high * 65535 / periods));
+        eye->edge[c] = eye_blend(eye, eye->edge[c], (uint32_t)((uint64_t)edges * 65535 / periods));
+    }
+    eye->captures++;
+    eye->periods = periods;
+    return periods;
+}
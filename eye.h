@@ -0,0 +1,35 @@
+#ifndef EYE_H
+#define EYE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "analyzer.h"
+
+// Persistence (eye diagram) view: every period of a capture is folded onto
+// its rising edge and counted into a column per 1/128 of the window. The
+// counts come from the run boundaries, a few updates per period, never from
+// the single samples. Captures are blended with an exponential decay.
+
+#define EYE_COLUMNS 128
+
+typedef struct {
+    uint16_t high[EYE_COLUMNS];     // share of the folded periods high in the column, 0.16 fixed point, decayed
+    uint16_t edge[EYE_COLUMNS];     // share with an edge in the column
+    uint32_t span;                  // samples across the columns, 1.5 mean periods
+    uint32_t pre;                   // samples shown ahead of the rising edge
+    uint32_t decay_shift;           // the newest capture weighs 1 / 2^decay_shift
+    uint32_t captures;              // folded since the timebase was set
+    uint32_t periods;               // folded from the last capture
+    // per capture: high runs as +1 / -1 at their first / past-last column, edges per column
+    int32_t work_high[EYE_COLUMNS + 1];
+    uint32_t work_edge[EYE_COLUMNS];
+} eye_t;
+
+void eye_init(eye_t *eye, uint32_t decay_shift);
+// Forgets the accumulated captures and the timebase
+void eye_reset(eye_t *eye);
+// Folds the stored runs of the list into the view, returns the periods folded.
+// The window follows the mean period; a change of more than 1/8 starts over.
+uint32_t eye_accumulate(eye_t *eye, const edge_list_t *list);
+
+#endif // !EYE_H
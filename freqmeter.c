@@ -0,0 +1,99 @@
+#include "freqmeter.h"
+
+#include "freqmeter.pio.h"
+#include "units.h"
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <pico/stdlib.h>
+
+#define FREQMETER_DMA_COUNT 0xFFFFFFFFu
+// shortest period the program can follow: one pass through both loops
+#define FREQMETER_MIN_PERIOD_CYCLES 8
+
+// reads a consistent (edge count, timestamp) pair while the DMA keeps running
+static void freqmeter_snapshot(freqmeter_t *fm, uint32_t *edges, uint32_t *stamp) {
+    dma_channel_hw_t *hw = dma_channel_hw_addr(fm->dma_channel);
+    uint32_t count;
+    do {
+        count = hw->transfer_count;
+        *stamp = fm->stamp;
+    } while (count != hw->transfer_count);
+    *edges = FREQMETER_DMA_COUNT - count;
+}
+
+static void freqmeter_open_gate(freqmeter_t *fm) {
+    // the edge count runs down from 2^32, restart the channel long before it stops
+    if (dma_channel_hw_addr(fm->dma_channel)->transfer_count < FREQMETER_DMA_COUNT / 2) {
+        dma_channel_abort(fm->dma_channel);
+        dma_channel_set_trans_count(fm->dma_channel, FREQMETER_DMA_COUNT, true);
+    }
+    freqmeter_snapshot(fm, &fm->open_edges, &fm->open_stamp);
+    fm->open_time_us = time_us_64();
+}
+
+void setup_freqmeter(freqmeter_t *fm) {
+    fm->sm = pio_claim_unused_sm(fm->pio, true);
+    fm->offset = pio_add_program(fm->pio, &freqmeter_program);
+
+    pio_sm_config c = freqmeter_program_get_default_config(fm->offset);
+    sm_config_set_jmp_pin(&c, fm->pin);
+    sm_config_set_in_shift(&c, false, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv(&c, 1.0f);
+    pio_sm_init(fm->pio, fm->sm, fm->offset, &c);
+
+    fm->dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(fm->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(fm->pio, fm->sm, false));
+    dma_channel_configure(
+        fm->dma_channel,
+        &config,
+        &fm->stamp,
+        &fm->pio->rxf[fm->sm],
+        FREQMETER_DMA_COUNT,
+        true
+    );
+
+    pio_sm_set_enabled(fm->pio, fm->sm, true);
+    freqmeter_open_gate(fm);
+}
+
+void freqmeter_set_gate(freqmeter_t *fm, uint32_t gate_ms) {
+    fm->gate_ms = gate_ms;
+    freqmeter_open_gate(fm);
+}
+
+bool freqmeter_poll(freqmeter_t *fm, uint64_t *freq_mhz) {
+    uint64_t elapsed_us = time_us_64() - fm->open_time_us;
+    if (elapsed_us < fm->gate_ms * 1000ull) return false;
+
+    uint32_t edges, stamp;
+    freqmeter_snapshot(fm, &edges, &stamp);
+
+    // periods between the first edge after the gate opened and the last edge seen
+    uint32_t periods = edges - fm->open_edges;
+    if (fm->open_edges == 0 || periods == 0) {
+        // no reference edge yet: keep the gate open for slow signals, give up after max_gate_ms
+        if (elapsed_us < fm->max_gate_ms * 1000ull) {
+            if (fm->open_edges == 0 && edges > 0) freqmeter_open_gate(fm);
+            return false;
+        }
+        freqmeter_open_gate(fm);
+        *freq_mhz = 0;
+        return true;
+    }
+
+    // X counts down, so the timestamp difference is the number of decrements
+    uint64_t cycles = 2ull * (uint32_t)(fm->open_stamp - stamp) + 2ull * periods;
+    *freq_mhz = scaled_div((uint64_t)periods * clock_get_hz(clk_sys), 1000, cycles);
+
+    freqmeter_open_gate(fm);
+    return true;
+}
+
+uint64_t freqmeter_max_freq(freqmeter_t *fm) {
+    return (uint64_t)clock_get_hz(clk_sys) * 1000 / FREQMETER_MIN_PERIOD_CYCLES;
+}
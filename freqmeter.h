@@ -0,0 +1,33 @@
+#ifndef FREQMETER_H
+#define FREQMETER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <hardware/pio.h>
+
+// Reciprocal frequency counter: a PIO state machine timestamps every rising
+// edge, a DMA channel keeps only the latest timestamp and its transfer count
+// gives the number of edges. The frequency is the number of periods divided
+// by the time between the first and the last edge inside the gate.
+typedef struct {
+    uint pin;
+    PIO pio;
+    uint32_t gate_ms;
+    uint32_t max_gate_ms;   // gate is extended up to this while no full period was seen
+    uint sm;
+    uint offset;
+    int dma_channel;
+    volatile uint32_t stamp; // DMA destination, latest edge timestamp
+    uint32_t open_edges;
+    uint32_t open_stamp;
+    uint64_t open_time_us;
+} freqmeter_t;
+
+void setup_freqmeter(freqmeter_t *fm);
+void freqmeter_set_gate(freqmeter_t *fm, uint32_t gate_ms);
+// Returns true and the frequency in milli-Hz when a gate has closed
+bool freqmeter_poll(freqmeter_t *fm, uint64_t *freq_mhz);
+// Highest frequency in milli-Hz the state machine can follow at the current system clock
+uint64_t freqmeter_max_freq(freqmeter_t *fm);
+
+#endif // !FREQMETER_H
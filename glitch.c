@@ -0,0 +1,118 @@
+#include "glitch.h"
+
+#include "glitch.pio.h"
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <pico/stdlib.h>
+
+#define GLITCH_DMA_COUNT 0xFFFFFFFFu
+
+// the interrupt handler has no argument, one catcher per firmware
+static glitch_catcher_t *irq_catcher;
+
+static inline uint glitch_irq_num(glitch_catcher_t *gc) {
+    return pio_get_index(gc->pio) ? PIO1_IRQ_0 : PIO0_IRQ_0;
+}
+
+static void glitch_irq_handler(void) {
+    glitch_catcher_t *gc = irq_catcher;
+    gc->alarm_us = time_us_64();
+    gc->alarm = true;
+    // one interrupt per poll however fast the glitches come, the DMA counts them all
+    pio_set_irq0_source_enabled(gc->pio, pis_interrupt0 + gc->sm, false);
+}
+
+static void glitch_catcher_start(glitch_catcher_t *gc) {
+    // X counts passes of 2 cycles, the first test comes 2 cycles after the edge
+    uint32_t passes = gc->threshold_cycles / 2 - 1;
+    pio_sm_clear_fifos(gc->pio, gc->sm);
+    pio_sm_restart(gc->pio, gc->sm);
+    pio_sm_put(gc->pio, gc->sm, passes);
+    pio_sm_exec(gc->pio, gc->sm, pio_encode_pull(false, true));
+    pio_sm_exec(gc->pio, gc->sm, pio_encode_set(pio_y, 1));
+    pio_sm_exec(gc->pio, gc->sm, pio_encode_jmp(gc->offset + glitch_catcher_offset_start));
+    pio_interrupt_clear(gc->pio, gc->sm);
+    pio_sm_set_enabled(gc->pio, gc->sm, true);
+}
+
+void setup_glitch_catcher(glitch_catcher_t *gc) {
+    gc->sm = pio_claim_unused_sm(gc->pio, true);
+    gc->offset = pio_add_program(gc->pio, &glitch_catcher_program);
+
+    // the pin is only read, its function stays with the sampler
+    pio_sm_config c = glitch_catcher_program_get_default_config(gc->offset);
+    sm_config_set_in_pins(&c, gc->pin);
+    sm_config_set_jmp_pin(&c, gc->pin);
+    sm_config_set_in_shift(&c, true, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv(&c, 1.0f);
+    pio_sm_init(gc->pio, gc->sm, gc->offset, &c);
+
+    gc->dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(gc->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(gc->pio, gc->sm, false));
+    dma_channel_configure(
+        gc->dma_channel,
+        &config,
+        &gc->word,
+        &gc->pio->rxf[gc->sm],
+        GLITCH_DMA_COUNT,
+        true
+    );
+    gc->count_base = 0;
+    gc->cleared = 0;
+    gc->alarm = false;
+
+    irq_catcher = gc;
+    irq_set_exclusive_handler(glitch_irq_num(gc), glitch_irq_handler);
+    irq_set_enabled(glitch_irq_num(gc), true);
+
+    glitch_catcher_set_threshold(gc, gc->threshold_cycles);
+    pio_set_irq0_source_enabled(gc->pio, pis_interrupt0 + gc->sm, true);
+}
+
+void glitch_catcher_set_threshold(glitch_catcher_t *gc, uint32_t cycles) {
+    if (cycles < GLITCH_CATCHER_MIN_CYCLES) cycles = GLITCH_CATCHER_MIN_CYCLES;
+    if (cycles > GLITCH_CATCHER_MAX_CYCLES) cycles = GLITCH_CATCHER_MAX_CYCLES;
+    gc->threshold_cycles = cycles;
+
+    pio_sm_set_enabled(gc->pio, gc->sm, false);
+    glitch_catcher_start(gc);
+}
+
+bool glitch_catcher_poll(glitch_catcher_t *gc, uint64_t *time_us) {
+    // the count runs down from 2^32, restart the channel long before it stops
+    dma_channel_hw_t *hw = dma_channel_hw_addr(gc->dma_channel);
+    if (hw->transfer_count < GLITCH_DMA_COUNT / 2) {
+        dma_channel_abort(gc->dma_channel);
+        gc->count_base += GLITCH_DMA_COUNT - hw->transfer_count;
+        dma_channel_set_trans_count(gc->dma_channel, GLITCH_DMA_COUNT, true);
+    }
+
+    if (!gc->alarm) return false;
+    *time_us = gc->alarm_us;
+    gc->alarm = false;
+    // glitches since the interrupt was taken are counted only, the next one raises it again
+    pio_interrupt_clear(gc->pio, gc->sm);
+    pio_set_irq0_source_enabled(gc->pio, pis_interrupt0 + gc->sm, true);
+    return true;
+}
+
+uint32_t glitch_catcher_count(glitch_catcher_t *gc) {
+    uint32_t count = gc->count_base + (GLITCH_DMA_COUNT - dma_channel_hw_addr(gc->dma_channel)->transfer_count);
+    return count - gc->cleared;
+}
+
+void glitch_catcher_clear(glitch_catcher_t *gc) {
+    gc->cleared += glitch_catcher_count(gc);
+}
+
+uint32_t glitch_catcher_last(glitch_catcher_t *gc, uint8_t *level) {
+    uint32_t word = gc->word;
+    uint32_t passes = gc->threshold_cycles / 2 - 1;
+    *level = word & 1;
+    return 2 * (passes - (word >> 1)) + 2;
+}
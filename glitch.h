@@ -0,0 +1,43 @@
+#ifndef GLITCH_H
+#define GLITCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <hardware/pio.h>
+
+// Threshold range in system clock cycles; the program tests the pin every
+// 2 cycles, so a single-cycle pulse may slip through
+#define GLITCH_CATCHER_MIN_CYCLES 2
+#define GLITCH_CATCHER_MAX_CYCLES 0x10000
+
+// Glitch catcher: a PIO state machine times every run of the pin and pushes a
+// word for each one shorter than the threshold, a DMA channel keeps the latest
+// word and its transfer count gives the number of glitches, so nothing runs
+// on the CPU per glitch. The first glitch after every poll also raises an
+// interrupt that takes its time; the interrupt stays off until the next poll.
+typedef struct {
+    uint pin;
+    PIO pio;
+    uint32_t threshold_cycles;  // runs shorter than this are glitches, the one after a glitch up to 5 cycles longer too
+    uint sm;
+    uint offset;
+    int dma_channel;
+    volatile uint32_t word;     // DMA destination, word of the latest glitch
+    uint32_t count_base;        // glitches before the last restart of the DMA channel
+    uint32_t cleared;           // glitch count at the last glitch_catcher_clear
+    volatile uint64_t alarm_us; // time of the first glitch since the interrupt was re-armed
+    volatile bool alarm;        // interrupt taken, not polled yet
+} glitch_catcher_t;
+
+void setup_glitch_catcher(glitch_catcher_t *gc);
+// Restarts the state machine with the new threshold, clamped to the range above
+void glitch_catcher_set_threshold(glitch_catcher_t *gc, uint32_t cycles);
+// Returns true and the time of the glitch when the interrupt fired since the last call, then re-arms it
+bool glitch_catcher_poll(glitch_catcher_t *gc, uint64_t *time_us);
+// Glitches since the last clear, latched until then
+uint32_t glitch_catcher_count(glitch_catcher_t *gc);
+void glitch_catcher_clear(glitch_catcher_t *gc);
+// Width in system clock cycles (within 2) and level of the latest glitch
+uint32_t glitch_catcher_last(glitch_catcher_t *gc, uint8_t *level);
+
+#endif // !GLITCH_H
@@ -0,0 +1,846 @@
+// Host benchmark and known-answer check for analyzer.c. Synthetic signals are
+// packed LSB first into 32-bit words like the sampler PIO produces them; the
+// generator records every run, which gives the expected counts and pattern
+// independently of the analyzer. Exits with 1 if any check fails.
+//
+//   analyzer_bench [-w words] [-t min_seconds]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "analyzer.h"
+#include "units.h"
+#include "decoder.h"
+#include "eye.h"
+#include "ets.h"
+
+#define SAMPLE_RATE 10000000u
+#define GLITCH_THRESHOLD 3
+
+// Generator state: samples are written run by run, the runs are kept as the expected edge list
+typedef struct {
+    uint32_t *words;
+    uint32_t word_count;
+    uint32_t samples;       // written so far
+    uint32_t high_count;
+    uint32_t transitions;
+    edge_run_t *runs;
+    uint32_t run_capacity;
+    uint32_t run_count;
+    uint32_t rng;
+} generator_t;
+
+typedef void (*generator_fn)(generator_t *gen);
+
+static uint32_t gen_random(generator_t *gen) {
+    uint32_t x = gen->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->rng = x;
+    return x;
+}
+
+static int gen_full(const generator_t *gen) {
+    return gen->samples == gen->word_count * 32;
+}
+
+// Appends a run, cut at the end of the buffer
+static void gen_run(generator_t *gen, uint32_t level, uint32_t length) {
+    uint32_t room = gen->word_count * 32 - gen->samples;
+    if (length > room) length = room;
+    if (length == 0) return;
+
+    if (gen->run_count > 0 && gen->runs[gen->run_count - 1].level == level) {
+        gen->runs[gen->run_count - 1].length += length;
+    } else {
+        if (gen->run_count > 0) gen->transitions++;
+        if (gen->run_count < gen->run_capacity) {
+            gen->runs[gen->run_count].level = level;
+            gen->runs[gen->run_count].length = length;
+        }
+        gen->run_count++;
+    }
+
+    if (level) {
+        gen->high_count += length;
+        for (uint32_t i = 0; i < length; i++, gen->samples++) {
+            gen->words[gen->samples / 32] |= 1u << (gen->samples % 32);
+        }
+    } else {
+        gen->samples += length;
+    }
+}
+
+// 50 % square wave, 100 samples per period
+static void gen_square(generator_t *gen) {
+    while (!gen_full(gen)) {
+        gen_run(gen, 1, 50);
+        gen_run(gen, 0, 50);
+    }
+}
+
+// 250 samples per period, duty swept from 10 to 90 %
+static void gen_pwm(generator_t *gen) {
+    for (uint32_t duty = 10; !gen_full(gen); duty = duty < 90 ? duty + 1 : 10) {
+        gen_run(gen, 1, 250 * duty / 100);
+        gen_run(gen, 0, 250 - 250 * duty / 100);
+    }
+}
+
+// 64 samples per period, each half moved by up to 3 samples
+static void gen_jitter(generator_t *gen) {
+    while (!gen_full(gen)) {
+        gen_run(gen, 1, 29 + gen_random(gen) % 7);
+        gen_run(gen, 0, 29 + gen_random(gen) % 7);
+    }
+}
+
+// Half a period of the glitchy signal: 500 samples with 1..2 sample spikes of the other level
+static void gen_glitchy_half(generator_t *gen, uint32_t level) {
+    uint32_t left = 500;
+    while (left > 0) {
+        uint32_t part = 20 + gen_random(gen) % 200;
+        if (part > left) part = left;
+        gen_run(gen, level, part);
+        left -= part;
+        if (left > 2 && gen_random(gen) % 4 == 0) {
+            uint32_t spike = 1 + gen_random(gen) % 2;
+            gen_run(gen, level ^ 1, spike);
+            left -= spike;
+        }
+    }
+}
+
+// 1000 samples per period with spikes
+static void gen_glitchy(generator_t *gen) {
+    while (!gen_full(gen)) {
+        gen_glitchy_half(gen, 1);
+        gen_glitchy_half(gen, 0);
+    }
+}
+
+// 16 periods of an 8-sample clock, then 5000 samples idle low
+static void gen_burst(generator_t *gen) {
+    while (!gen_full(gen)) {
+        for (int i = 0; i < 16; i++) {
+            gen_run(gen, 1, 4);
+            gen_run(gen, 0, 4);
+        }
+        gen_run(gen, 0, 5000);
+    }
+}
+
+static void gen_constant(generator_t *gen) {
+    gen_run(gen, 0, gen->word_count * 32);
+}
+
+static const struct {
+    const char *name;
+    generator_fn fn;
+} signals[] = {
+    {"square", gen_square},
+    {"pwm", gen_pwm},
+    {"jitter", gen_jitter},
+    {"glitchy", gen_glitchy},
+    {"burst", gen_burst},
+    {"constant", gen_constant},
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Repeats expr for at least min_s and prints the throughput in samples/s, for the passes over a capture
+#define BENCH(label, samples, min_s, expr) do { \
+        uint32_t iterations = 0; \
+        double t0 = now_s(), elapsed; \
+        do { \
+            expr; \
+            iterations++; \
+            elapsed = now_s() - t0; \
+        } while (elapsed < (min_s)); \
+        printf("  %-28s %10.1f Msamples/s\n", label, (double)(samples) * iterations / elapsed / 1e6); \
+    } while (0)
+
+// Constant-time queries: repeats expr in batches, so the clock is not what gets
+// measured, and prints the time per call
+#define BENCH_CALL_BATCH 1024
+#define BENCH_CALL(label, min_s, expr) do { \
+        uint64_t calls = 0; \
+        double t0 = now_s(), elapsed; \
+        do { \
+            for (int batch = 0; batch < BENCH_CALL_BATCH; batch++) { \
+                expr; \
+            } \
+            calls += BENCH_CALL_BATCH; \
+            elapsed = now_s() - t0; \
+        } while (elapsed < (min_s)); \
+        printf("  %-28s %10.1f ns/call\n", label, elapsed * 1e9 / calls); \
+    } while (0)
+
+static int failures = 0;
+
+static void check(int ok, const char *signal, const char *what) {
+    if (!ok) {
+        printf("  FAIL %s: %s\n", signal, what);
+        failures++;
+    }
+}
+
+static int same_result(const analysis_result_t *a, const analysis_result_t *b) {
+    return a->high_count == b->high_count && a->transitions == b->transitions &&
+           a->pulse_widths[0] == b->pulse_widths[0] && a->pulse_widths[1] == b->pulse_widths[1] &&
+           a->total_samples == b->total_samples && a->estimated_freq_mhz == b->estimated_freq_mhz &&
+           a->avg_high_pulse_q8 == b->avg_high_pulse_q8 && a->avg_low_pulse_q8 == b->avg_low_pulse_q8 &&
+           a->duty_bp == b->duty_bp && a->signal_type == b->signal_type;
+}
+
+static int same_run_stats(const run_stats_t *a, const run_stats_t *b) {
+    return a->count == b->count && a->min == b->min && a->max == b->max && a->sum == b->sum && a->sum_sq == b->sum_sq;
+}
+
+// Fixed point mean and standard deviation against double, within one LSB
+static int same_moments(const run_stats_t *stats) {
+    if (stats->count < 2) return run_stats_stddev_q8(stats) == 0;
+    double mean = (double)stats->sum / stats->count;
+    double stddev = sqrt((double)stats->sum_sq / stats->count - mean * mean);
+    return fabs(run_stats_mean_q8(stats) - mean * 256.0) <= 1.0 && fabs(run_stats_stddev_q8(stats) - stddev * 256.0) <= 1.0;
+}
+
+static void check_format(uint64_t freq_mhz, const char *expected) {
+    char s[24];
+    printFreqMilliHz(s, freq_mhz);
+    if (strcmp(s, expected) != 0) {
+        printf("  FAIL printFreqMilliHz(%llu): \"%s\", expected \"%s\"\n", (unsigned long long)freq_mhz, s, expected);
+        failures++;
+    }
+}
+
+// Pulse statistics recomputed from the generated runs, the partial first and last run left out
+static int same_stats(const pulse_stats_t *stats, const generator_t *gen) {
+    run_stats_t width[2] = {{.min = UINT32_MAX}, {.min = UINT32_MAX}};
+    run_stats_t period = {.min = UINT32_MAX};
+    uint32_t glitches = 0;
+    uint32_t histogram[PULSE_HISTOGRAM_BINS] = {0};
+
+    for (uint32_t i = 1; i + 1 < gen->run_count; i++) {
+        const edge_run_t *run = &gen->runs[i];
+        run_stats_t *w = &width[run->level];
+        uint32_t bin = 0;
+        while (bin + 1 < PULSE_HISTOGRAM_BINS && run->length >= 2u << bin) bin++;
+
+        w->count++;
+        w->sum += run->length;
+        w->sum_sq += (uint64_t)run->length * run->length;
+        if (run->length < w->min) w->min = run->length;
+        if (run->length > w->max) w->max = run->length;
+        if (run->length < GLITCH_THRESHOLD) glitches++;
+        histogram[bin]++;
+
+        if (!run->level && i > 1) {
+            uint32_t p = gen->runs[i - 1].length + run->length;
+            period.count++;
+            period.sum += p;
+            period.sum_sq += (uint64_t)p * p;
+            if (p < period.min) period.min = p;
+            if (p > period.max) period.max = p;
+        }
+    }
+    return same_run_stats(&width[0], &stats->width[0]) && same_run_stats(&width[1], &stats->width[1]) &&
+           same_run_stats(&period, &stats->period) &&
+           glitches == stats->glitches && memcmp(histogram, stats->histogram, sizeof(histogram)) == 0;
+}
+
+// Expected pattern: the complete runs from the second one on, spikes marked
+static void expected_pattern(const generator_t *gen, reduce_t out[128], uint32_t avg_fullpulse_width) {
+    uint32_t cursor = 0;
+    for (uint32_t i = 1; i + 1 < gen->run_count && i < gen->run_capacity && cursor < 128; i++) {
+        out[cursor++] = gen->runs[i].length > avg_fullpulse_width / 2 ? (reduce_t)gen->runs[i].level : reduced_pin;
+    }
+}
+
+// Flags of one display column straight from the samples
+static uint8_t expected_column(const uint32_t *words, uint32_t samples, uint32_t from, uint32_t width) {
+    uint8_t flags = 0;
+    for (uint32_t t = from; t < from + width && t < samples; t++) {
+        uint32_t level = (words[t / 32] >> (t % 32)) & 1;
+        flags |= level ? PYRAMID_HIGH : PYRAMID_LOW;
+        if (t > 0 && level != ((words[(t - 1) / 32] >> ((t - 1) % 32)) & 1)) flags |= PYRAMID_EDGE;
+    }
+    return flags;
+}
+
+#define COLUMNS 128
+
+// Every zoom from one sample per column to the whole capture, at the start,
+// the middle and the end of the capture; with and without the pyramid. The
+// pyramid levels start their columns at a multiple of the column width.
+static int same_columns(const pyramid_t *pyramid, const edge_list_t *list, const uint32_t *words, uint32_t samples) {
+    uint8_t columns[COLUMNS];
+    for (uint32_t zoom = 0; (uint32_t)(COLUMNS >> 1) << zoom < samples; zoom++) {
+        uint32_t width = 1u << zoom;
+        uint32_t window = COLUMNS * width;
+        uint32_t starts[3] = {0, samples / 2 + 3, samples > window ? samples - window + 5 : 7};
+        for (int i = 0; i < 3; i++) {
+            uint32_t start = starts[i];
+            if (zoom >= PYRAMID_BUCKET_SHIFT && pyramid->levels) start &= ~(width - 1);
+            render_columns(pyramid, list, start, zoom, columns, COLUMNS);
+            for (uint32_t c = 0; c < COLUMNS; c++) {
+                uint32_t from = start + c * width;
+                if (columns[c] != (from < samples ? expected_column(words, samples, from, width) : 0)) return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Odd sized chunks leave plane words half filled between the appends
+#define PYRAMID_CHUNK_WORDS 1000
+
+static int same_pyramid(const pyramid_t *a, const pyramid_t *b) {
+    if (a->levels != b->levels || a->total_samples != b->total_samples) return 0;
+    for (uint32_t level = 0; level < a->levels; level++) {
+        if (a->buckets[level] != b->buckets[level]) return 0;
+        for (uint32_t i = 0; i < a->buckets[level]; i++) {
+            if (pyramid_bucket(a, level, i) != pyramid_bucket(b, level, i)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Block size of the firmware (BUFFER_SIZE / SAMPLER_BLOCKS), the early stop
+// settings are the CONVERGE_* of analyzer.h like there
+#define STREAM_BLOCK_WORDS 2048
+
+// Appends the buffer block by block like core1 does, returns the blocks taken
+// until convergence_update stopped the capture, 0 if it ran to the end
+static uint32_t stream_until_converged(edge_list_t *list, const uint32_t *words, uint32_t word_count) {
+    convergence_t conv = {.min_transitions = CONVERGE_MIN_TRANSITIONS, .agree_blocks = CONVERGE_AGREE_BLOCKS, .tolerance_ppm = CONVERGE_TOLERANCE_PPM,
+                          .duty_tolerance_bp = CONVERGE_DUTY_TOLERANCE_BP};
+    convergence_reset(&conv);
+    edge_list_reset(list);
+    for (uint32_t w = 0; w < word_count; w += STREAM_BLOCK_WORDS) {
+        uint32_t n = word_count - w < STREAM_BLOCK_WORDS ? word_count - w : STREAM_BLOCK_WORDS;
+        edge_list_append(list, words + w, n);
+        if (convergence_update(&conv, list) && w + n < word_count) {
+            edge_list_finish(list);
+            return w / STREAM_BLOCK_WORDS + 1;
+        }
+    }
+    edge_list_finish(list);
+    return 0;
+}
+
+// The folded periods recomputed sample by sample: a column takes the level of
+// the last sample at or before it, an edge counts in the column of its sample
+static int same_eye(const eye_t *eye, const uint32_t *words, uint32_t samples, const generator_t *gen) {
+    uint32_t high[EYE_COLUMNS] = {0};
+    uint32_t edges[EYE_COLUMNS] = {0};
+    uint32_t periods = 0;
+    uint64_t scale = ((uint64_t)EYE_COLUMNS << 32) / eye->span;
+
+    uint32_t start = gen->runs[0].length;
+    for (uint32_t i = 1; i < gen->run_count; start += gen->runs[i++].length) {
+        if (!gen->runs[i].level || start < eye->pre) continue;
+        uint32_t w0 = start - eye->pre;
+        if (w0 + eye->span > samples) break;
+        for (uint32_t t = w0; t < w0 + eye->span; t++) {
+            uint32_t level = (words[t / 32] >> (t % 32)) & 1;
+            uint32_t c = (uint32_t)(((uint64_t)(t - w0) * scale) >> 32);
+            uint32_t next = t + 1 < w0 + eye->span ? (uint32_t)(((uint64_t)(t + 1 - w0) * scale) >> 32) : EYE_COLUMNS;
+            for (uint32_t col = c; col < next; col++) high[col] += level;
+            if (t > 0 && level != ((words[(t - 1) / 32] >> ((t - 1) % 32)) & 1)) edges[c]++;
+        }
+        periods++;
+    }
+    if (periods != eye->periods) return 0;
+    for (uint32_t c = 0; c < EYE_COLUMNS; c++) {
+        uint32_t e = edges[c] < periods ? edges[c] : periods;
+        if (eye->high[c] != (uint64_t)high[c] * 65535 / periods || eye->edge[c] != (uint64_t)e * 65535 / periods) return 0;
+    }
+    return 1;
+}
+
+// Decoder test signals are drawn sample range by sample range into zeroed buffers
+#define DECODE_WORDS 1024
+
+static void set_high(uint32_t *words, uint32_t from, uint32_t to) {
+    for (uint32_t t = from; t < to && t < DECODE_WORDS * 32; t++) {
+        words[t / 32] |= 1u << (t % 32);
+    }
+}
+
+static void check_frames(const decode_ring_t *ring, uint32_t count, const uint8_t *values, const uint8_t *flags,
+                         uint32_t expected, const char *what) {
+    int ok = count == expected;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const decoded_frame_t *frame = decode_ring_get(ring, count - 1 - i);
+        ok = frame->value == values[i] && frame->flags == flags[i];
+    }
+    check(ok, "decoder", what);
+}
+
+// A list out of room decodes a prefix of the frames and says so, nothing past its stored runs
+static void check_truncated(const decoder_t *decoder, const decode_ring_t *ring, uint32_t count, const uint8_t *values,
+                            const uint8_t *flags, uint32_t expected, const char *what) {
+    check(decoder->truncated && count < expected, "decoder", what);
+    check_frames(ring, count, values, flags, count, what);
+}
+
+// Cycle by cycle model of sampler_rle in sampler.pio, one instruction per
+// sample; the pin is read by the `jmp pin` of the cycle. Returns the words pushed.
+static uint32_t simulate_rle(const uint32_t *samples, uint32_t sample_count, uint32_t *out, uint32_t capacity) {
+    uint32_t x = 0xFFFFFFFFu;
+    uint32_t pc = 0;
+    uint32_t count = 0;
+    for (uint32_t t = 0; t < sample_count && count < capacity; t++) {
+        uint32_t pin = (samples[t / 32] >> (t % 32)) & 1;
+        switch (pc) {
+            case 0: pc = pin ? 2 : 1; break;                    // low: jmp pin low_end
+            case 1: pc = x-- ? 0 : 2; break;                    // jmp x-- low
+            case 2: pc = 3; break;                              // low_end: in null, 1
+            case 3: out[count++] = x << 1; pc = 4; break;       // in x, 31 (autopush)
+            case 4: x = 0xFFFFFFFFu; pc = 5; break;             // mov x, ~null
+            case 5: pc = pin ? 6 : 0; break;                    // jmp pin high, .wrap
+            case 6: pc = pin ? 8 : 7; break;                    // high: jmp pin high_count
+            case 7: pc = 9; break;                              // jmp high_end
+            case 8: pc = x-- ? 6 : 9; break;                    // high_count: jmp x-- high
+            case 9: pc = 10; break;                             // high_end: in y, 1
+            case 10: out[count++] = (x << 1) | 1; pc = 11; break; // in x, 31 (autopush)
+            case 11: x = 0xFFFFFFFFu; pc = 12; break;           // mov x, ~null
+            case 12: pc = pin ? 6 : 13; break;                  // jmp pin high
+            case 13: pc = 0; break;                             // jmp low
+        }
+    }
+    return count;
+}
+
+// Run-length capture of a 13 / 19 sample pulse train through the program model,
+// starting with the pin low and high: every complete run comes back exact, so
+// does the duty, and the first word the sampler drops takes any bogus run with it
+#define RLE_WORDS 64
+static void check_rle(void) {
+    static uint32_t samples[RLE_WORDS];
+    static uint32_t words[RLE_WORDS * 32];
+    static edge_run_t runs[RLE_WORDS * 32];
+    const uint32_t high = 13, low = 19;
+
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        memset(samples, 0, sizeof(samples));
+        for (uint32_t t = 0; t < RLE_WORDS * 32; t++) {
+            if ((t + phase * low) % (high + low) >= low) samples[t / 32] |= 1u << (t % 32);
+        }
+        uint32_t count = simulate_rle(samples, RLE_WORDS * 32, words, RLE_WORDS * 32);
+
+        edge_list_t list;
+        edge_list_init(&list, runs, RLE_WORDS * 32);
+        edge_list_reset(&list);
+        edge_list_append_rle(&list, words + 1, count - 1);
+        edge_list_finish(&list);
+
+        const char *name = phase ? "RLE from high" : "RLE from low";
+        const run_stats_t *width = list.stats.width;
+        check(width[1].count > 0 && width[1].min == high && width[1].max == high, name, "high run lengths");
+        check(width[0].count > 0 && width[0].min == low && width[0].max == low, name, "low run lengths");
+        // mean high over mean period, the two levels need not have as many complete runs
+        uint64_t high_mean = width[1].sum * width[0].count, low_mean = width[0].sum * width[1].count;
+        check(high_mean * 10000 / (high_mean + low_mean) == high * 10000 / (high + low), name, "duty");
+        // the pin starting high gives an empty low run first, dropped with the first word
+        check(!phase || list.first_level == 1, name, "no bogus leading low run");
+    }
+
+    // single pulses of either level on 40 sample stretches of the other: at the
+    // shortest length the program captures they come back within a sample,
+    // 2 samples shorter they are lost and the stretches either side merge
+    const uint32_t shortest[2] = {7, 6};
+    for (uint32_t level = 0; level < 2; level++) {
+        for (uint32_t lost = 0; lost < 2; lost++) {
+            uint32_t pulse = shortest[level] - 2 * lost;
+            memset(samples, 0, sizeof(samples));
+            for (uint32_t t = 0; t < RLE_WORDS * 32; t++) {
+                uint32_t pin = t % (40 + pulse) >= 40 ? level : level ^ 1;
+                if (pin) samples[t / 32] |= 1u << (t % 32);
+            }
+            uint32_t count = simulate_rle(samples, RLE_WORDS * 32, words, RLE_WORDS * 32);
+
+            edge_list_t list;
+            edge_list_init(&list, runs, RLE_WORDS * 32);
+            edge_list_reset(&list);
+            edge_list_append_rle(&list, words + 1, count - 1);
+            edge_list_finish(&list);
+
+            const char *name = level ? "RLE short high pulse" : "RLE short low pulse";
+            const run_stats_t *width = list.stats.width;
+            if (lost) {
+                check(width[level].count == 0 && width[level ^ 1].min > 80, name, "too short, merged");
+            } else {
+                check(width[level].count > 0 && width[level].min + 1 >= pulse && width[level].max <= pulse + 1,
+                      name, "shortest captured");
+            }
+        }
+    }
+}
+
+// "Hello" 8N1 at 8.68 samples per bit (115200 baud at 1 MS/s), SPI mode 0 with
+// and without a chip select, and
+// I2C with an address, one data byte and a NACK
+static void check_decoders(double min_s) {
+    static uint32_t line[DECODE_WORDS], clock[DECODE_WORDS], data[DECODE_WORDS], select[DECODE_WORDS];
+    static edge_run_t runs[4][DECODE_WORDS * 32];
+    static edge_run_t cut_runs[16];
+    edge_list_t lists[4];
+    decode_ring_t ring = {0};
+
+    for (int i = 0; i < 4; i++) edge_list_init(&lists[i], runs[i], DECODE_WORDS * 32);
+
+    // UART
+    const uint8_t text[] = "Hello";
+    const uint8_t no_flags[8] = {0};
+    double bit = 1000000.0 / 115200.0;
+    double t = 100.0;
+    set_high(line, 0, 100);
+    for (int c = 0; c < 5; c++) {
+        uint32_t frame = 0x200 | (text[c] << 1); // start bit 0, data LSB first, stop bit 1
+        for (int b = 0; b < 10; b++, t += bit) {
+            if ((frame >> b) & 1) set_high(line, (uint32_t)t, (uint32_t)(t + bit));
+        }
+        set_high(line, (uint32_t)t, (uint32_t)(t + 3 * bit)); // idle between bytes
+        t += 3 * bit;
+    }
+    set_high(line, (uint32_t)t, DECODE_WORDS * 32);
+    edge_list_build(&lists[0], line, DECODE_WORDS);
+
+    decoder_t uart = {.protocol = DECODE_UART, .clock = &lists[0], .min_pulse = 2};
+    check_frames(&ring, decode_capture(&uart, &ring), text, no_flags, 5, "UART frames");
+    check(uart.bit_q8 > (uint32_t)((bit - 0.1) * 256) && uart.bit_q8 < (uint32_t)((bit + 0.1) * 256), "decoder", "UART auto-baud");
+    check(!uart.truncated, "decoder", "UART not truncated");
+
+    // room for the runs of the first bytes only
+    edge_list_t cut_line;
+    edge_list_init(&cut_line, cut_runs, 16);
+    edge_list_build(&cut_line, line, DECODE_WORDS);
+    decoder_t uart_cut = {.protocol = DECODE_UART, .clock = &cut_line, .min_pulse = 2};
+    uint32_t cut_frames = decode_capture(&uart_cut, &ring);
+    check(cut_frames > 0, "decoder", "UART frames before the truncation");
+    check_truncated(&uart_cut, &ring, cut_frames, text, no_flags, 5, "UART frames of a truncated list");
+
+    // SPI mode 0: data changes on the falling edge, 8 clocks of 10 samples per byte, a pause between bytes
+    const uint8_t spi_bytes[] = {0xA5, 0x3C, 0xFF};
+    memset(clock, 0, sizeof(clock));
+    memset(data, 0, sizeof(data));
+    uint32_t s = 50;
+    for (int c = 0; c < 3; c++, s += 100) {
+        for (int b = 7; b >= 0; b--, s += 10) {
+            if ((spi_bytes[c] >> b) & 1) set_high(data, s, s + 10);
+            set_high(clock, s + 5, s + 10);
+        }
+    }
+    edge_list_build(&lists[1], clock, DECODE_WORDS);
+    edge_list_build(&lists[2], data, DECODE_WORDS);
+
+    decoder_t spi = {.protocol = DECODE_SPI, .clock = &lists[1], .data = &lists[2]};
+    check_frames(&ring, decode_capture(&spi, &ring), spi_bytes, no_flags, 3, "SPI frames");
+
+    // SPI with a chip select: the capture opens on the last 3 clocks of a byte,
+    // then CS goes high and the next selection carries two whole bytes
+    memset(clock, 0, sizeof(clock));
+    memset(data, 0, sizeof(data));
+    memset(select, 0, sizeof(select));
+    for (s = 20; s < 50; s += 10) {
+        set_high(data, s, s + 10);
+        set_high(clock, s + 5, s + 10);
+    }
+    set_high(select, 60, 100);
+    s = 110;
+    for (int c = 0; c < 2; c++) {
+        for (int b = 7; b >= 0; b--, s += 10) {
+            if ((spi_bytes[c] >> b) & 1) set_high(data, s, s + 10);
+            set_high(clock, s + 5, s + 10);
+        }
+    }
+    set_high(select, s + 10, DECODE_WORDS * 32);
+    edge_list_build(&lists[1], clock, DECODE_WORDS);
+    edge_list_build(&lists[2], data, DECODE_WORDS);
+    edge_list_build(&lists[3], select, DECODE_WORDS);
+
+    decoder_t spi_cs = {.protocol = DECODE_SPI, .clock = &lists[1], .data = &lists[2], .select = &lists[3]};
+    check_frames(&ring, decode_capture(&spi_cs, &ring), spi_bytes, no_flags, 2, "SPI frames after a partial byte");
+
+    // I2C: START, address 0x50 write + ACK, 0x42 + NACK, STOP; 20 samples per SCL period
+    const uint8_t i2c_bytes[] = {0xA0, 0x42, 0x00};
+    const uint8_t i2c_flags[] = {DECODE_FLAG_START, DECODE_FLAG_NACK, DECODE_FLAG_STOP};
+    memset(clock, 0, sizeof(clock));
+    memset(data, 0, sizeof(data));
+    set_high(clock, 0, 100);
+    set_high(data, 0, 90);      // START: SDA falls while SCL is high
+    s = 100;
+    for (int c = 0; c < 2; c++) {
+        uint32_t word = (i2c_bytes[c] << 1) | (c == 1); // 8 data bits, then ACK (0) / NACK (1)
+        for (int b = 8; b >= 0; b--, s += 20) {
+            if ((word >> b) & 1) set_high(data, s, s + 20);
+            set_high(clock, s + 10, s + 20);
+        }
+    }
+    set_high(clock, s + 5, DECODE_WORDS * 32);
+    set_high(data, s + 10, DECODE_WORDS * 32); // STOP: SDA rises while SCL is high
+    edge_list_build(&lists[1], clock, DECODE_WORDS);
+    edge_list_build(&lists[2], data, DECODE_WORDS);
+
+    decoder_t i2c = {.protocol = DECODE_I2C, .clock = &lists[1], .data = &lists[2]};
+    check_frames(&ring, decode_capture(&i2c, &ring), i2c_bytes, i2c_flags, 3, "I2C frames");
+
+    // SCL out of room in the address byte while SDA goes on to the STOP
+    edge_list_t cut_clock;
+    edge_list_init(&cut_clock, cut_runs, 12);
+    edge_list_build(&cut_clock, clock, DECODE_WORDS);
+    decoder_t i2c_cut = {.protocol = DECODE_I2C, .clock = &cut_clock, .data = &lists[2]};
+    check_truncated(&i2c_cut, &ring, decode_capture(&i2c_cut, &ring), i2c_bytes, i2c_flags, 3, "I2C frames of a truncated clock");
+
+    printf("decoders:\n");
+    volatile uint32_t sink = 0;
+    BENCH("decode_capture (UART)", DECODE_WORDS * 32, min_s, sink += decode_capture(&uart, &ring));
+    BENCH("decode_capture (I2C)", DECODE_WORDS * 32, min_s, sink += decode_capture(&i2c, &ring));
+    (void)sink;
+}
+
+// Square wave of 7.3 samples per period, high for 2.9 of them, the first
+// rising edge at 3.4: the sample clock walks through every phase of it, so the
+// fold places the edges within a small part of a sample
+#define ETS_WORDS 1024
+static void check_ets(double min_s) {
+    static uint32_t words[ETS_WORDS];
+    static edge_run_t runs[ETS_WORDS * 32];
+    static ets_t ets;
+    const double period = 7.3, high = 2.9, rise = 3.4;
+    edge_list_t list;
+
+    memset(words, 0, sizeof(words));
+    for (uint32_t t = 0; t < ETS_WORDS * 32; t++) {
+        double phase = fmod(t - rise + 100 * period, period);
+        if (phase < high) words[t / 32] |= 1u << (t % 32);
+    }
+    edge_list_init(&list, runs, ETS_WORDS * 32);
+    edge_list_build(&list, words, ETS_WORDS);
+
+    uint32_t periods = ets_fold(&ets, &list);
+    double period_got = ets.period_q16 / 65536.0;
+    double high_got = ets.high_q16 / 65536.0;
+    double rise_got = ets.rise_q16 / 65536.0;
+    printf("ets: %u periods, period %.4f high %.3f rise %.3f samples, duty %u bp\n",
+           periods, period_got, high_got, rise_got, ets.duty_bp);
+    check(periods == ETS_MAX_PERIODS, "ets", "periods folded");
+    check(fabs(period_got - period) < 0.001, "ets", "period");
+    check(fabs(high_got - high) < 0.05, "ets", "high time");
+    check(fabs(rise_got - rise) < 0.1, "ets", "rising edge");
+    check(abs((int)ets.duty_bp - (int)(high / period * 10000)) < 70, "ets", "duty");
+    // each edge is spread over the sample it fell in, it sits where the share
+    // crosses one half: the rising edge 1/8 of the period in, the falling one high / period later
+    uint32_t up = 0, down = 0;
+    while (up < ETS_COLUMNS && ets.high[up] < 32768) up++;
+    for (down = up; down < ETS_COLUMNS && ets.high[down] >= 32768; down++);
+    check(abs((int)up - ETS_COLUMNS / 8) <= 1 && abs((int)down - (int)((0.125 + high / period) * ETS_COLUMNS)) <= 1,
+          "ets", "folded waveform");
+
+    // too few periods leave nothing folded
+    edge_list_build(&list, words, 1);
+    check(ets_fold(&ets, &list) == 0 && ets.periods == 0, "ets", "short capture");
+
+    edge_list_build(&list, words, ETS_WORDS);
+    volatile uint32_t sink = 0;
+    BENCH("ets_fold", ETS_WORDS * 32, min_s, sink += ets_fold(&ets, &list));
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    uint32_t word_count = 32768; // BUFFER_SIZE of the firmware
+    double min_s = 0.2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:t:")) != -1) {
+        switch (opt) {
+            case 'w': word_count = strtoul(optarg, NULL, 0); break;
+            case 't': min_s = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-w words] [-t min_seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (word_count == 0) return 1;
+
+    uint32_t samples = word_count * 32;
+    uint32_t *words = malloc(word_count * sizeof(uint32_t));
+    // one run per sample at most, so neither list is ever truncated
+    edge_run_t *expected_runs = malloc(samples * sizeof(edge_run_t));
+    edge_run_t *runs = malloc(samples * sizeof(edge_run_t));
+    if (!words || !expected_runs || !runs) return 1;
+
+    check_format(999, "<1 Hz");
+    check_format(1000, "1.000 Hz");
+    check_format(12345, "12.35 Hz");
+    check_format(999900, "999.9 Hz");
+    check_format(3579545000ull, "3.580 MHz");
+    check_format(14000000000ull, "14.00 MHz");
+    check_format(250000000000ull, "250.0 MHz");
+    check_format(1000000000000ull, ">1 GHz");
+    // rounding carries into the next decade and unit
+    check_format(9999600, "10.00 KHz");
+    check_format(99995, "100.0 Hz");
+    check_format(999960000, "1.000 MHz");
+    check_format(999960000000ull, ">1 GHz");
+
+    char percent[16];
+    printPercent(percent, 5000);
+    check(strcmp(percent, "50.0%") == 0, "format", "printPercent");
+    char nanos[16];
+    printNanosX100(nanos, 50);
+    check(strcmp(nanos, "0.50ns") == 0, "format", "printNanosX100 below 1 ns");
+    printNanosX100(nanos, 1234);
+    check(strcmp(nanos, "12.3ns") == 0, "format", "printNanosX100 ns");
+    printNanosX100(nanos, 99960);
+    check(strcmp(nanos, "1.00us") == 0, "format", "printNanosX100 carry into us");
+    printNanosX100(nanos, 123456789);
+    check(strcmp(nanos, "1.23ms") == 0, "format", "printNanosX100 ms");
+
+    printf("%u words, %u samples per buffer\n", word_count, samples);
+
+    for (size_t s = 0; s < sizeof(signals) / sizeof(signals[0]); s++) {
+        const char *name = signals[s].name;
+        generator_t gen = {
+            .words = words,
+            .word_count = word_count,
+            .runs = expected_runs,
+            .run_capacity = samples,
+            .rng = 0x2545F491u
+        };
+        memset(words, 0, word_count * sizeof(uint32_t));
+        signals[s].fn(&gen);
+
+        printf("%s: %u transitions, %u high samples\n", name, gen.transitions, gen.high_count);
+
+        // known answers
+        analysis_result_t res = analyze_signal_buffer(words, word_count, SAMPLE_RATE);
+        analysis_result_t ref = analyze_signal_buffer_bitwise(words, word_count, SAMPLE_RATE);
+        check(res.high_count == gen.high_count, name, "analyze_signal_buffer high count");
+        check(res.transitions == gen.transitions, name, "analyze_signal_buffer transitions");
+        check(res.total_samples == samples, name, "analyze_signal_buffer total samples");
+        check(same_result(&res, &ref), name, "analyze_signal_buffer differs from the bit-serial reference");
+
+        edge_list_t list;
+        edge_list_init(&list, runs, samples);
+        edge_list_set_glitch_threshold(&list, GLITCH_THRESHOLD);
+        edge_list_build(&list, words, word_count);
+        check(!list.truncated && list.count == gen.run_count, name, "edge list run count");
+        check(memcmp(list.runs, gen.runs, gen.run_count * sizeof(edge_run_t)) == 0, name, "edge list runs");
+
+        analysis_result_t from_list = analyze_edge_list(&list, SAMPLE_RATE);
+        check(same_result(&from_list, &res), name, "analyze_edge_list differs from analyze_signal_buffer");
+
+        check(detect_signal_activity(&list) == (gen.transitions > 0), name, "detect_signal_activity");
+        check(same_stats(&list.stats, &gen), name, "pulse statistics");
+
+        check(calculate_duty_cycle(&list) == (uint64_t)gen.high_count * 10000 / samples, name, "calculate_duty_cycle");
+        check(res.estimated_freq_mhz == (gen.transitions > 1 ? (uint64_t)((unsigned __int128)gen.transitions * SAMPLE_RATE * 500 / samples) : 0),
+              name, "estimated frequency");
+        check(same_moments(&list.stats.period), name, "period mean / stddev");
+
+        // same threshold as the firmware
+        uint32_t avg_fullpulse_width = gen.transitions ? gen.high_count / (gen.transitions * 2) : 0;
+        reduce_t reduced[128] = {0};
+        reduce_t expected[128] = {0};
+        reduce_edges_to_32(&list, 0, reduced, avg_fullpulse_width);
+        expected_pattern(&gen, expected, avg_fullpulse_width);
+        check(memcmp(reduced, expected, sizeof(reduced)) == 0, name, "reduce_edges_to_32");
+
+        uint32_t *pyramid_storage = malloc(PYRAMID_STORAGE_WORDS(word_count) * sizeof(uint32_t));
+        if (!pyramid_storage) return 1;
+        pyramid_t pyramid, no_pyramid;
+        pyramid_init(&pyramid, pyramid_storage, PYRAMID_STORAGE_WORDS(word_count));
+        pyramid_build(&pyramid, words, word_count, 1);
+        pyramid_init(&no_pyramid, NULL, 0);
+        pyramid_build(&no_pyramid, words, word_count, 1);
+        check(pyramid.levels > 0 && (pyramid.levels == PYRAMID_MAX_LEVELS || pyramid.buckets[pyramid.levels - 1] == 1),
+              name, "pyramid levels");
+        check(same_columns(&pyramid, &list, words, samples), name, "render_columns from the pyramid");
+        check(same_columns(&no_pyramid, &list, words, samples), name, "render_columns from the edge list");
+
+        pyramid_t chunked;
+        uint32_t *chunked_storage = malloc(PYRAMID_STORAGE_WORDS(word_count) * sizeof(uint32_t));
+        if (!chunked_storage) return 1;
+        pyramid_init(&chunked, chunked_storage, PYRAMID_STORAGE_WORDS(word_count));
+        for (uint32_t w = 0; w < word_count; w += PYRAMID_CHUNK_WORDS) {
+            pyramid_append(&chunked, words + w, word_count - w < PYRAMID_CHUNK_WORDS ? word_count - w : PYRAMID_CHUNK_WORDS, 1);
+        }
+        pyramid_finish(&chunked);
+        check(same_pyramid(&chunked, &pyramid), name, "pyramid appended in chunks");
+        free(chunked_storage);
+
+        // early stop: never without edges, and the estimate it stops on holds for the whole buffer
+        static edge_run_t stream_runs[4096];
+        edge_list_t stream;
+        edge_list_init(&stream, stream_runs, 4096);
+        uint32_t stopped = stream_until_converged(&stream, words, word_count);
+        printf("  capture stopped after %u of %u blocks\n", stopped ? stopped : (word_count + STREAM_BLOCK_WORDS - 1) / STREAM_BLOCK_WORDS,
+               (word_count + STREAM_BLOCK_WORDS - 1) / STREAM_BLOCK_WORDS);
+        if (stopped) {
+            analysis_result_t early = analyze_edge_list(&stream, SAMPLE_RATE);
+            int32_t duty_error = (int32_t)early.duty_bp - (int32_t)res.duty_bp;
+            int64_t freq_error = (int64_t)early.estimated_freq_mhz - (int64_t)res.estimated_freq_mhz;
+            int64_t freq_error_ppm = res.estimated_freq_mhz ? freq_error * 1000000 / (int64_t)res.estimated_freq_mhz : 0;
+            printf("  early: duty %+d bp, frequency %+lld ppm\n", duty_error, (long long)freq_error_ppm);
+            check(llabs(freq_error_ppm) <= CONVERGE_TOLERANCE_PPM && abs(duty_error) <= CONVERGE_DUTY_TOLERANCE_BP,
+                  name, "early stop within the tolerances");
+        }
+        check(gen.transitions > 0 || !stopped, name, "convergence without edges");
+
+        // a capture folded twice decays to itself
+        static eye_t eye;
+        eye_init(&eye, 2);
+        uint32_t folded = eye_accumulate(&eye, &list);
+        check(folded == 0 ? gen.transitions < 4 : same_eye(&eye, words, samples, &gen), name, "eye_accumulate");
+        if (folded) {
+            eye_accumulate(&eye, &list);
+            check(same_eye(&eye, words, samples, &gen), name, "eye_accumulate decay");
+        }
+
+        // throughput
+        volatile uint32_t sink = 0;
+        uint8_t columns[COLUMNS];
+        BENCH("analyze_signal_buffer", samples, min_s, res = analyze_signal_buffer(words, word_count, SAMPLE_RATE); sink += res.transitions);
+        BENCH("analyze_signal_buffer_bitwise", samples, min_s, ref = analyze_signal_buffer_bitwise(words, word_count, SAMPLE_RATE); sink += ref.transitions);
+        BENCH("edge_list_build", samples, min_s, edge_list_build(&list, words, word_count); sink += list.count);
+        BENCH_CALL("detect_signal_activity", min_s, sink += detect_signal_activity(&list));
+        BENCH_CALL("calculate_duty_cycle", min_s, sink += calculate_duty_cycle(&list));
+        BENCH_CALL("reduce_edges_to_32", min_s, reduce_edges_to_32(&list, 0, reduced, avg_fullpulse_width); sink += reduced[0]);
+        BENCH("pyramid_build", samples, min_s, pyramid_build(&pyramid, words, word_count, 1); sink += pyramid.levels);
+        // whole capture in 128 columns: what a redraw after a button press costs
+        BENCH_CALL("render_columns", min_s, render_columns(&pyramid, &list, 0, pyramid.levels - 1 + PYRAMID_BUCKET_SHIFT, columns, COLUMNS); sink += columns[0]);
+        // one sample per column at the end of the capture: the runs are sought, not walked from the start
+        BENCH_CALL("render_columns (runs, end)", min_s, render_columns(&no_pyramid, &list, samples - COLUMNS, 0, columns, COLUMNS); sink += columns[0]);
+        BENCH_CALL("eye_accumulate", min_s, sink += eye_accumulate(&eye, &list));
+        (void)sink;
+        free(pyramid_storage);
+    }
+
+    check_rle();
+    check_decoders(min_s);
+    check_ets(min_s);
+
+    free(words);
+    free(expected_runs);
+    free(runs);
+
+    if (failures) {
+        printf("%d checks FAILED\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Minimal SUMP client for testing the USB CDC port without PulseView:
+// queries the device, runs one capture and prints a summary per channel.
+//
+//   sump_client [-d /dev/ttyACM0] [-r rate_hz] [-n samples] [-t channel:level]
+//               [-a after_percent] [-o samples.bin]
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "sump_protocol.h"
+
+static int open_port(const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200); // ignored by CDC ACM
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int send_short(int fd, uint8_t cmd) {
+    return write(fd, &cmd, 1) == 1 ? 0 : -1;
+}
+
+static int send_long(int fd, uint8_t cmd, uint32_t arg) {
+    uint8_t buf[SUMP_CMD_LENGTH] = {cmd, arg, arg >> 8, arg >> 16, arg >> 24};
+    return write(fd, buf, sizeof(buf)) == sizeof(buf) ? 0 : -1;
+}
+
+// Reads exactly length bytes, giving up after timeout_ms without any data
+static size_t read_exact(int fd, uint8_t *buf, size_t length, int timeout_ms) {
+    size_t got = 0;
+    while (got < length) {
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+        struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        if (select(fd + 1, &set, NULL, NULL, &tv) <= 0) break;
+
+        ssize_t n = read(fd, buf + got, length - got);
+        if (n <= 0) break;
+        got += n;
+    }
+    return got;
+}
+
+static uint32_t be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Prints the metadata and returns the number of probes
+static int query_metadata(int fd, uint32_t *memory, uint32_t *max_rate) {
+    int probes = 8;
+    uint8_t key;
+
+    send_short(fd, SUMP_CMD_METADATA);
+    while (read_exact(fd, &key, 1, 500) == 1 && key != SUMP_META_END) {
+        uint8_t value[64];
+        if (key == SUMP_META_NAME || key == SUMP_META_FIRMWARE) {
+            size_t n = 0;
+            while (n < sizeof(value) - 1 && read_exact(fd, &value[n], 1, 500) == 1 && value[n]) n++;
+            value[n] = 0;
+            printf("  %s: %s\n", key == SUMP_META_NAME ? "device" : "firmware", value);
+        } else if (key == SUMP_META_PROBES || key == SUMP_META_PROTOCOL) {
+            if (read_exact(fd, value, 1, 500) != 1) break;
+            if (key == SUMP_META_PROBES) probes = value[0];
+            printf("  %s: %u\n", key == SUMP_META_PROBES ? "probes" : "protocol", value[0]);
+        } else if ((key >> 5) == 1) {
+            if (read_exact(fd, value, 4, 500) != 4) break;
+            if (key == SUMP_META_SAMPLE_MEMORY) *memory = be32(value);
+            if (key == SUMP_META_MAX_RATE) *max_rate = be32(value);
+            printf("  key 0x%02x: %u\n", key, be32(value));
+        } else {
+            fprintf(stderr, "unknown metadata key 0x%02x\n", key);
+            break;
+        }
+    }
+    return probes;
+}
+
+static void print_channel(const uint8_t *samples, uint32_t count, int channel, double rate) {
+    uint32_t high = 0, edges = 0, first_edge = 0, last_edge = 0;
+    int last = samples[0] >> channel & 1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        int level = samples[i] >> channel & 1;
+        high += level;
+        if (level != last) {
+            if (edges == 0) first_edge = i;
+            last_edge = i;
+            edges++;
+        }
+        last = level;
+    }
+
+    printf("CH%d: %u edges, duty %.1f%%", channel, edges, count ? high * 100.0 / count : 0.0);
+    if (edges > 2) {
+        printf(", %.1f Hz", (edges - 1) / 2.0 * rate / (last_edge - first_edge));
+    }
+    printf("\n     ");
+    for (uint32_t i = 0; i < count && i < 64; i++) {
+        putchar('0' + (samples[i] >> channel & 1));
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    const char *device = "/dev/ttyACM0";
+    const char *output = NULL;
+    double rate = 1000000.0;
+    uint32_t count = 4096;
+    int trigger_channel = -1, trigger_level = 1;
+    uint32_t after_percent = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:r:n:t:a:o:")) != -1) {
+        switch (opt) {
+            case 'd': device = optarg; break;
+            case 'r': rate = atof(optarg); break;
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 't': sscanf(optarg, "%d:%d", &trigger_channel, &trigger_level); break;
+            case 'a': after_percent = strtoul(optarg, NULL, 0); break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-d device] [-r rate_hz] [-n samples] [-t channel:level] [-a after_percent] [-o file]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    int fd = open_port(device);
+    if (fd < 0) return 1;
+
+    for (int i = 0; i < 5; i++) send_short(fd, SUMP_CMD_RESET);
+    usleep(100000);
+    tcflush(fd, TCIFLUSH);
+
+    char id[5] = {0};
+    send_short(fd, SUMP_CMD_ID);
+    if (read_exact(fd, (uint8_t *)id, 4, 1000) != 4 || memcmp(id, SUMP_ID, 4) != 0) {
+        fprintf(stderr, "no SUMP device on %s (got \"%s\")\n", device, id);
+        return 1;
+    }
+    printf("%s: %s\n", device, id);
+
+    uint32_t memory = 0, max_rate = 0;
+    int probes = query_metadata(fd, &memory, &max_rate);
+
+    count &= ~3u;
+    if (count == 0) count = 4;
+    if (memory && count > memory) count = memory;
+    uint32_t delay = (uint64_t)count * after_percent / 100 & ~3u;
+    if (delay == 0) delay = 4;
+    uint32_t divider = rate >= SUMP_CLOCK_HZ ? 0 : (uint32_t)(SUMP_CLOCK_HZ / rate) - 1;
+
+    send_long(fd, SUMP_CMD_DIVIDER, divider);
+    if (count <= 0x40000) {
+        send_long(fd, SUMP_CMD_READ_DELAY, ((delay / 4 - 1) << 16) | (count / 4 - 1));
+    } else {
+        send_long(fd, SUMP_CMD_READ_COUNT, count / 4 - 1);
+        send_long(fd, SUMP_CMD_DELAY_COUNT, delay / 4 - 1);
+    }
+    // group 0 only: one byte per sample
+    send_long(fd, SUMP_CMD_FLAGS, 0x0E << SUMP_FLAG_GROUPS_SHIFT);
+    if (trigger_channel >= 0) {
+        send_long(fd, SUMP_CMD_TRIGGER_MASK, 1u << trigger_channel);
+        send_long(fd, SUMP_CMD_TRIGGER_VALUE, trigger_level ? 1u << trigger_channel : 0);
+    } else {
+        send_long(fd, SUMP_CMD_TRIGGER_MASK, 0);
+    }
+
+    double actual_rate = (double)SUMP_CLOCK_HZ / (divider + 1);
+    if (max_rate && actual_rate > max_rate) actual_rate = max_rate;
+    printf("capturing %u samples at %.0f Hz", count, actual_rate);
+    if (trigger_channel >= 0) printf(", trigger CH%d %s, %u%% after", trigger_channel, trigger_level ? "high" : "low", after_percent);
+    printf("\n");
+
+    uint8_t *samples = malloc(count);
+    send_short(fd, SUMP_CMD_RUN);
+    // no timeout for the first byte while waiting for the trigger
+    size_t got = read_exact(fd, samples, 1, 60000);
+    got += read_exact(fd, samples + got, count - got, 2000);
+    if (got != count) {
+        fprintf(stderr, "short read: %zu of %u samples\n", got, count);
+        return 1;
+    }
+
+    // newest sample comes first
+    for (uint32_t i = 0; i < count / 2; i++) {
+        uint8_t t = samples[i];
+        samples[i] = samples[count - 1 - i];
+        samples[count - 1 - i] = t;
+    }
+
+    for (int c = 0; c < probes && c < 8; c++) {
+        print_channel(samples, count, c, actual_rate);
+    }
+
+    if (output) {
+        FILE *f = fopen(output, "wb");
+        if (!f || fwrite(samples, 1, count, f) != count) {
+            fprintf(stderr, "%s: %s\n", output, strerror(errno));
+            return 1;
+        }
+        fclose(f);
+        printf("samples written to %s\n", output);
+    }
+
+    free(samples);
+    close(fd);
+    return 0;
+}
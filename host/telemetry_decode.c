@@ -0,0 +1,208 @@
+// Decoder for the binary telemetry on the debug UART: splits the stream at
+// the zero bytes, decodes the COBS frames and prints each record as text.
+// Anything between the frames (text of the higher debug levels) is passed
+// through unchanged.
+//
+//   telemetry_decode [-d /dev/ttyUSB0] [-b baudrate]
+//   telemetry_decode < capture.bin
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+#include "decoder.h"
+
+static const char *signal_names[] = {"unknown", "constant", "square", "periodic"};
+
+static int open_port(const char *path, int baudrate) {
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    speed_t speed;
+    switch (baudrate) {
+        case 9600: speed = B9600; break;
+        case 57600: speed = B57600; break;
+        case 115200: speed = B115200; break;
+        case 230400: speed = B230400; break;
+        case 460800: speed = B460800; break;
+        case 921600: speed = B921600; break;
+        default:
+            fprintf(stderr, "unsupported baudrate %d\n", baudrate);
+            close(fd);
+            return -1;
+    }
+
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIFLUSH);
+    return fd;
+}
+
+static void print_pattern(uint32_t reduced, uint32_t spikes) {
+    for (int i = 0; i < 32; i++) {
+        putchar((spikes >> i) & 1 ? '|' : (reduced >> i) & 1 ? '1' : '0');
+    }
+}
+
+static void print_capture(const telemetry_capture_t *rec) {
+    printf("#%u block %u%s%s: %u samples at %u S/s, overruns %u",
+           rec->capture_id, rec->block_seq,
+           rec->flags & TELEMETRY_FLAG_RLE ? " rle" : "",
+           rec->flags & TELEMETRY_FLAG_TRIGGERED ? " triggered" : "",
+           rec->total_samples, rec->sample_rate, rec->overruns);
+    if (rec->trigger_sample != TELEMETRY_NO_TRIGGER) {
+        printf(", trigger at %u", rec->trigger_sample);
+    }
+    printf("\n");
+
+    if (!(rec->flags & TELEMETRY_FLAG_ACTIVE)) {
+        printf("  no signal, level %s\n", rec->high_count ? "HIGH" : "LOW");
+        return;
+    }
+
+    const char *type = rec->signal_type < sizeof(signal_names) / sizeof(signal_names[0]) ? signal_names[rec->signal_type] : "?";
+    printf("  %s, %u transitions, duty %u.%02u%%, high %u samples\n",
+           type, rec->transitions, rec->duty_bp / 100, rec->duty_bp % 100, rec->high_count);
+    printf("  frequency %llu.%03llu Hz%s",
+           (unsigned long long)(rec->freq_mhz / 1000), (unsigned long long)(rec->freq_mhz % 1000),
+           rec->flags & TELEMETRY_FLAG_COUNTER ? " (counter)" : "");
+    if (rec->counter_freq_mhz && !(rec->flags & TELEMETRY_FLAG_COUNTER)) {
+        printf(", counter %llu.%03llu Hz",
+               (unsigned long long)(rec->counter_freq_mhz / 1000), (unsigned long long)(rec->counter_freq_mhz % 1000));
+    }
+    printf("\n");
+    printf("  avg pulse high %.2f, low %.2f samples\n", rec->avg_high_pulse_q8 / 256.0, rec->avg_low_pulse_q8 / 256.0);
+    printf("  reduced ");
+    print_pattern(rec->reduced, rec->reduced_spikes);
+    printf("\n");
+}
+
+static void print_channel(const telemetry_channel_t *rec) {
+    printf("  CH%u: %u transitions, duty %u.%02u%%, %llu.%03llu Hz\n",
+           rec->channel, rec->transitions, rec->duty_bp / 100, rec->duty_bp % 100,
+           (unsigned long long)(rec->freq_mhz / 1000), (unsigned long long)(rec->freq_mhz % 1000));
+}
+
+static void print_pulses(const telemetry_pulses_t *rec) {
+    printf("  period %u..%u, mean %.2f, stddev %.2f over %u periods\n",
+           rec->period_min, rec->period_max, rec->period_mean_q8 / 256.0, rec->period_stddev_q8 / 256.0, rec->periods);
+    printf("  high %u..%u, low %u..%u, %u glitches\n", rec->high_min, rec->high_max, rec->low_min, rec->low_max, rec->glitches);
+    printf("  widths");
+    for (int b = 0; b < TELEMETRY_HISTOGRAM_BINS; b++) {
+        if (rec->histogram[b]) printf(" %u+:%u", 1u << b, rec->histogram[b]);
+    }
+    printf("\n");
+}
+
+static void print_frames(const telemetry_frames_t *rec) {
+    static const char *protocols[] = {"-", "UART", "SPI", "I2C"};
+    printf("  %s", rec->protocol < 4 ? protocols[rec->protocol] : "?");
+    if (rec->baud) printf(" %u baud", rec->baud);
+    if (rec->flags & TELEMETRY_FRAMES_TRUNCATED) printf(" (cut short, edge list full)");
+    printf(":");
+    for (int i = 0; i < rec->count && i < TELEMETRY_FRAMES; i++) {
+        uint8_t value = rec->frames[i] & 0xFF;
+        uint8_t flags = rec->frames[i] >> 8;
+        if (flags & DECODE_FLAG_STOP) {
+            printf(" P");
+            continue;
+        }
+        printf(" %s%02X%s%s", flags & DECODE_FLAG_START ? "S" : "", value,
+               flags & DECODE_FLAG_NACK ? "~" : "", flags & DECODE_FLAG_ERROR ? "!" : "");
+    }
+    printf("\n");
+}
+
+// Returns 0 if the segment is not a valid record
+static int decode_record(const uint8_t *segment, size_t length) {
+    union {
+        uint8_t bytes[TELEMETRY_MAX_FRAME];
+        telemetry_capture_t capture;
+        telemetry_channel_t channel;
+        telemetry_pulses_t pulses;
+        telemetry_frames_t frames;
+    } rec;
+
+    if (length == 0 || length > TELEMETRY_MAX_FRAME) return 0;
+    size_t n = telemetry_cobs_decode(segment, length, rec.bytes);
+
+    if (n == sizeof(rec.capture) && rec.bytes[0] == TELEMETRY_RECORD_CAPTURE) {
+        print_capture(&rec.capture);
+        return 1;
+    }
+    if (n == sizeof(rec.channel) && rec.bytes[0] == TELEMETRY_RECORD_CHANNEL) {
+        print_channel(&rec.channel);
+        return 1;
+    }
+    if (n == sizeof(rec.pulses) && rec.bytes[0] == TELEMETRY_RECORD_PULSES) {
+        print_pulses(&rec.pulses);
+        return 1;
+    }
+    if (n == sizeof(rec.frames) && rec.bytes[0] == TELEMETRY_RECORD_FRAMES) {
+        print_frames(&rec.frames);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *device = NULL;
+    int baudrate = 115200;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:")) != -1) {
+        switch (opt) {
+            case 'd': device = optarg; break;
+            case 'b': baudrate = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-d device] [-b baudrate]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int fd = STDIN_FILENO;
+    if (device) {
+        fd = open_port(device, baudrate);
+        if (fd < 0) return 1;
+    }
+
+    // text can be longer than any frame, it is passed through in pieces
+    uint8_t segment[256];
+    size_t length = 0;
+    uint8_t buf[256];
+    ssize_t got;
+
+    while ((got = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < got; i++) {
+            if (buf[i] != 0) {
+                if (length == sizeof(segment)) {
+                    fwrite(segment, 1, length, stdout);
+                    length = 0;
+                }
+                segment[length++] = buf[i];
+                continue;
+            }
+            if (!decode_record(segment, length)) {
+                fwrite(segment, 1, length, stdout);
+            }
+            length = 0;
+        }
+        fflush(stdout);
+    }
+    fwrite(segment, 1, length, stdout);
+
+    if (device) close(fd);
+    return 0;
+}
@@ -1,38 +1,146 @@
 #include "sampler.h"
 
 #include "sampler.pio.h"
-#include <string.h>
+#include <hardware/sync.h>
+#include <hardware/clocks.h>
+#include <pico/stdlib.h>
+
+const sampler_profile_t sampler_profiles[SAMPLER_PROFILE_COUNT] = {
+    [SAMPLER_PROFILE_STANDARD] = {"standard", 128000000, VREG_VOLTAGE_DEFAULT, 4, 4},
+    [SAMPLER_PROFILE_FAST] = {"fast", 200000000, VREG_VOLTAGE_1_15, 1, 8},
+    [SAMPLER_PROFILE_TURBO] = {"turbo", 250000000, VREG_VOLTAGE_1_20, 1, 8},
+};
 
 int dma_channel;
+int dma_channel_chained;
 volatile bool capture_complete = false;
+volatile bool continuous_capture = false;
+volatile bool triggered_capture = false;
+volatile bool rle_capture = false;
+sampler_t *ring_sampler = NULL;
+volatile uint32_t ring_blocks = 0;
+// block each of the two ring channels is filling
+static uint ring_next[2];
+
+// trigger program as loaded, widened to the channel count
+static uint16_t trigger_instructions[32];
+static pio_program_t trigger_program;
+static uint trigger_offset;
+static sampler_trigger_t active_trigger;
+static uint32_t trigger_post_samples;
+static double trigger_sample_rate;
+static uint rle_offset;
+static uint32_t capture_words;
+
+// ring channel `slot` has filled its block, the chain has just started the other
+// channel on the next one. A block still held there is being overwritten: one
+// not taken yet is withdrawn, one the consumer holds is marked clobbered.
+static void ring_block_done(uint slot, int channel) {
+    uint index = ring_next[slot];
+    sampler_block_t *block = &ring_sampler->blocks[index];
+    sampler_block_t *next = &ring_sampler->blocks[ring_next[slot ^ 1]];
+
+    ring_blocks++;
+    if (continuous_capture) {
+        if (next->state != SAMPLER_BLOCK_FREE) {
+            ring_sampler->overruns++;
+            if (next->state == SAMPLER_BLOCK_READY) {
+                next->state = SAMPLER_BLOCK_FREE;
+            } else {
+                next->clobbered = true;
+            }
+        }
+        if (block->state != SAMPLER_BLOCK_BUSY) {
+            block->seq = ++ring_sampler->block_seq;
+            block->sample_rate = ring_sampler->sample_rate;
+            block->clobbered = false;
+            block->state = SAMPLER_BLOCK_READY;
+        }
+    }
+    // re-arm without triggering for the block after the other channel's, the chain starts it
+    ring_next[slot] = (index + 2) % SAMPLER_BLOCKS;
+    dma_channel_set_write_addr(channel, ring_sampler->blocks[ring_next[slot]].data, false);
+}
 
 void dma_handler() {
     if (dma_channel_get_irq0_status(dma_channel)) {
         dma_channel_acknowledge_irq0(dma_channel);
-        capture_complete = true;
-        dma_channel_abort(dma_channel);
+        if (ring_sampler) {
+            ring_block_done(0, dma_channel);
+        } else {
+            capture_complete = true;
+            dma_channel_abort(dma_channel);
+        }
+    }
+    if (dma_channel_get_irq0_status(dma_channel_chained)) {
+        dma_channel_acknowledge_irq0(dma_channel_chained);
+        if (ring_sampler) {
+            ring_block_done(1, dma_channel_chained);
+        }
+    }
+}
+
+bool sampler_apply_profile(sampler_t *sampler, const sampler_profile_t *profile) {
+    // the voltage goes up before the clock and needs a moment to settle
+    vreg_set_voltage(profile->vreg);
+    busy_wait_ms(10);
+    if (!set_sys_clock_hz(profile->sys_hz, false)) return false;
+
+    // clk_peri follows clk_sys (PICO_CLOCK_ADJUST_PERI_CLOCK_WITH_SYS_CLOCK), keep the UART and I2C within spec
+    if (profile->sys_hz > SAMPLER_PERI_MAX_HZ) {
+        clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 48 * MHZ, 48 * MHZ);
     }
+    sampler->profile = profile;
+    return true;
+}
+
+float sampler_min_clkdiv(const sampler_t *sampler) {
+    if (!sampler->profile) return SAMPLER_MIN_CLKDIV;
+
+    // sample_rate * channel_count / 32 words per second against sys_hz / dma_cycles_per_word
+    uint32_t budget = (sampler->channel_count * sampler->profile->dma_cycles_per_word + 31) / 32;
+    return budget > sampler->profile->min_clkdiv ? budget : sampler->profile->min_clkdiv;
 }
 
 // returns real sampling frequency 
 double setup_sampler(sampler_t *sampler)  {
     uint sm = 0;
-    uint offset = pio_add_program(sampler->pio, &sampler_program);
-    
-    gpio_set_function(sampler->pin, GPIO_FUNC_NULL);
+    const pio_program_t *program;
+    pio_sm_config (*get_default_config)(uint offset);
 
-    pio_gpio_init(sampler->pio, sampler->pin);
-    pio_sm_set_consecutive_pindirs(sampler->pio, sm, sampler->pin, 1, false);
+    switch (sampler->channel_count) {
+        case 2: program = &sampler_x2_program; get_default_config = sampler_x2_program_get_default_config; break;
+        case 4: program = &sampler_x4_program; get_default_config = sampler_x4_program_get_default_config; break;
+        case 8: program = &sampler_x8_program; get_default_config = sampler_x8_program_get_default_config; break;
+        default:
+            sampler->channel_count = 1;
+            program = &sampler_program;
+            get_default_config = sampler_program_get_default_config;
+            break;
+    }
+    // claimed before any other program is set up on this PIO, pio_claim_unused_sm would hand it out otherwise
+    pio_sm_claim(sampler->pio, sm);
+    sampler->trigger_sm = pio_claim_unused_sm(sampler->pio, true);
+    uint offset = pio_add_program(sampler->pio, program);
+    
+    for (uint i = 0; i < sampler->channel_count; i++) {
+        gpio_set_function(sampler->pin + i, GPIO_FUNC_NULL);
+        pio_gpio_init(sampler->pio, sampler->pin + i);
+    }
+    pio_sm_set_consecutive_pindirs(sampler->pio, sm, sampler->pin, sampler->channel_count, false);
     
-    pio_sm_config c = sampler_program_get_default_config(offset);
+    pio_sm_config c = get_default_config(offset);
     sm_config_set_in_pins(&c, sampler->pin);
     
     const float cycles_per_sample = 1.0f; 
-    float div = 4.0; // sampling as fast as we can 
+    float div = sampler_min_clkdiv(sampler); // sampling as fast as we can
     sm_config_set_clkdiv(&c, div);
 
+    // per channel: every cycle takes one sample of each channel
     double achieved_sm_clock = (double)clock_get_hz(clk_sys) / (double)div;
     double achieved_sample_rate = achieved_sm_clock / (double)cycles_per_sample;
+    sampler->clkdiv = div;
+    sampler->sample_rate = achieved_sample_rate;
     
     sm_config_set_in_shift(&c, true, true, 32);
     sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
@@ -40,48 +148,463 @@ double setup_sampler(sampler_t *sampler)  {
     pio_sm_init(sampler->pio, sm, offset, &c);
 
     dma_channel = dma_claim_unused_channel(true);
+    dma_channel_chained = dma_claim_unused_channel(true);
     dma_channel_set_irq0_enabled(dma_channel, true);
+    dma_channel_set_irq0_enabled(dma_channel_chained, true);
     irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
     irq_set_enabled(DMA_IRQ_0, true);
 
     return achieved_sample_rate;
 }
 
-void start_capture(sampler_t *sampler) {
-    capture_complete = false;
-    memset((void*)sampler->sample_buffer, 0, sampler->buffer_size * sizeof(uint32_t));
-    
-    dma_channel_config config = dma_channel_get_default_config(dma_channel);
+static dma_channel_config sampler_dma_config(sampler_t *sampler, uint sm, int channel, int chain_to) {
+    dma_channel_config config = dma_channel_get_default_config(channel);
     channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
     channel_config_set_read_increment(&config, false);
     channel_config_set_write_increment(&config, true);
-    channel_config_set_dreq(&config, pio_get_dreq(sampler->pio, 0, false));
+    channel_config_set_dreq(&config, pio_get_dreq(sampler->pio, sm, false));
+    channel_config_set_chain_to(&config, chain_to);
+    return config;
+}
+
+static void run_state_machine(sampler_t *sampler) {
+    pio_sm_clear_fifos(sampler->pio, 0);
+    pio_sm_restart(sampler->pio, 0);
+    pio_sm_set_enabled(sampler->pio, 0, true);
+}
+
+void start_capture(sampler_t *sampler) {
+    start_capture_words(sampler, sampler->buffer_size);
+}
+
+void start_capture_words(sampler_t *sampler, uint32_t word_count) {
+    capture_complete = false;
+    capture_words = word_count;
+    
+    // the DMA overwrites the buffer, no need to clear it first
+    dma_channel_config config = sampler_dma_config(sampler, 0, dma_channel, dma_channel);
     
     dma_channel_configure(
         dma_channel,
         &config,
         sampler->sample_buffer,
         &sampler->pio->rxf[0],
-        sampler->buffer_size,
+        word_count,
         false
     );
     
     // run PIO state machine
-    pio_sm_clear_fifos(sampler->pio, 0);
-    pio_sm_restart(sampler->pio, 0);
-    pio_sm_set_enabled(sampler->pio, 0, true);
+    run_state_machine(sampler);
     dma_channel_start(dma_channel);
 }
 
+sampler_block_t *poll_capture(sampler_t *sampler) {
+    if (!capture_complete || capture_words == 0) return NULL;
+
+    pio_sm_set_enabled(sampler->pio, 0, false);
+    sampler_block_t *block = &sampler->blocks[0];
+    block->data = sampler->sample_buffer;
+    block->word_count = capture_words;
+    block->seq = ++sampler->block_seq;
+    block->sample_rate = sampler->sample_rate;
+    block->trigger_sample = SAMPLER_NO_TRIGGER;
+    block->rle = false;
+    block->clobbered = false;
+    block->state = SAMPLER_BLOCK_BUSY;
+    capture_words = 0;
+    return block;
+}
+
 void wait_capture_blocking(sampler_t *sampler) {
     dma_channel_wait_for_finish_blocking(dma_channel);
 }
 
 void stop_capture(sampler_t *sampler) {
     pio_sm_set_enabled(sampler->pio, 0, false);
+    capture_words = 0;
+    if (!capture_complete) {
+        capture_complete = true;
+        dma_channel_abort(dma_channel);
+        dma_channel_acknowledge_irq0(dma_channel);
+    }
+}
+
+// Lays the blocks out over the buffer and points the two chained channels at
+// the first two, reading from state machine `sm`
+static void arm_ring(sampler_t *sampler, uint sm) {
+    const int channels[2] = {dma_channel, dma_channel_chained};
+    uint32_t block_words = sampler->buffer_size / SAMPLER_BLOCKS;
+
+    for (uint i = 0; i < SAMPLER_BLOCKS; i++) {
+        sampler_block_t *block = &sampler->blocks[i];
+        block->data = sampler->sample_buffer + i * block_words;
+        block->word_count = block_words;
+        block->seq = 0;
+        block->trigger_sample = SAMPLER_NO_TRIGGER;
+        block->rle = false;
+        block->clobbered = false;
+        block->state = SAMPLER_BLOCK_FREE;
+    }
+    for (uint i = 0; i < 2; i++) {
+        dma_channel_config config = sampler_dma_config(sampler, sm, channels[i], channels[i ^ 1]);
+        dma_channel_configure(
+            channels[i],
+            &config,
+            sampler->blocks[i].data,
+            &sampler->pio->rxf[sm],
+            block_words,
+            false
+        );
+        ring_next[i] = i;
+    }
+
+    ring_blocks = 0;
+    ring_sampler = sampler;
+}
+
+static void disarm_ring(sampler_t *sampler, uint sm) {
+    const int channels[2] = {dma_channel, dma_channel_chained};
+
+    // break the chain first, an aborted channel could otherwise trigger the other one
+    for (uint i = 0; i < 2; i++) {
+        dma_channel_config config = sampler_dma_config(sampler, sm, channels[i], channels[i]);
+        dma_channel_set_config(channels[i], &config, false);
+    }
+    for (uint i = 0; i < 2; i++) {
+        dma_channel_abort(channels[i]);
+        dma_channel_acknowledge_irq0(channels[i]);
+    }
+
+    ring_sampler = NULL;
+}
+
+// next word the ring writes, the channel still running owns it
+static uint32_t ring_position(sampler_t *sampler) {
+    int channel = dma_channel_is_busy(dma_channel) ? dma_channel : dma_channel_chained;
+    const uint32_t *write = (const uint32_t *)dma_channel_hw_addr(channel)->write_addr;
+    return (uint32_t)(write - sampler->sample_buffer) % sampler->buffer_size;
+}
+
+void start_continuous_capture(sampler_t *sampler) {
+    sampler->block_seq = 0;
+    sampler->overruns = 0;
+    arm_ring(sampler, 0);
+    continuous_capture = true;
+
+    run_state_machine(sampler);
+    dma_channel_start(dma_channel);
+}
+
+void stop_continuous_capture(sampler_t *sampler) {
+    pio_sm_set_enabled(sampler->pio, 0, false);
+    disarm_ring(sampler, 0);
+    continuous_capture = false;
+}
+
+// Copies the trigger program with every `in pins, 1` widened to the channel count
+static uint load_trigger_program(sampler_t *sampler, const pio_program_t *program) {
+    trigger_program = *program;
+    for (uint i = 0; i < program->length; i++) {
+        uint16_t instr = program->instructions[i];
+        // IN from pins, the bit count sits in the low 5 bits
+        if ((instr & 0xE0E0) == pio_instr_bits_in) {
+            instr = (instr & ~0x1F) | sampler->channel_count;
+        }
+        trigger_instructions[i] = instr;
+    }
+    trigger_program.instructions = trigger_instructions;
+    return pio_add_program(sampler->pio, &trigger_program);
+}
+
+void start_triggered_capture(sampler_t *sampler, const sampler_trigger_t *trigger) {
+    uint sm = sampler->trigger_sm;
+    bool falling = trigger->mode == SAMPLER_TRIGGER_FALLING || trigger->mode == SAMPLER_TRIGGER_LOW;
+    bool edge = trigger->mode == SAMPLER_TRIGGER_RISING || trigger->mode == SAMPLER_TRIGGER_FALLING;
+
+    active_trigger = *trigger;
+    trigger_offset = load_trigger_program(sampler, falling ? &sampler_trigger_falling_program : &sampler_trigger_rising_program);
+
+    pio_sm_config c;
+    uint entry;
+    if (falling) {
+        c = sampler_trigger_falling_program_get_default_config(trigger_offset);
+        entry = edge ? sampler_trigger_falling_offset_arm : sampler_trigger_falling_offset_pre;
+    } else {
+        c = sampler_trigger_rising_program_get_default_config(trigger_offset);
+        entry = edge ? sampler_trigger_rising_offset_arm : sampler_trigger_rising_offset_pre;
+    }
+    sm_config_set_in_pins(&c, sampler->pin);
+    sm_config_set_jmp_pin(&c, sampler->pin + trigger->channel);
+    sm_config_set_in_shift(&c, true, true, 32);
+
+    // same sample rate as the free-running program, below a divider of 4 as fast as 4 cycles allow
+    uint32_t div_q8 = (uint32_t)(sampler->clkdiv * (256.0f / SAMPLER_TRIGGER_CYCLES) + 0.5f);
+    if (div_q8 < 256) div_q8 = 256;
+    sm_config_set_clkdiv_int_frac(&c, div_q8 >> 8, div_q8 & 0xFF);
+    trigger_sample_rate = (double)clock_get_hz(clk_sys) * 256.0 / ((double)div_q8 * SAMPLER_TRIGGER_CYCLES);
+    pio_sm_init(sampler->pio, sm, trigger_offset + entry, &c);
+
+    // the partial word and the pre-trigger count follow the samples in the ring
+    uint8_t pre_percent = trigger->pre_percent > 100 ? 100 : trigger->pre_percent;
+    uint32_t post_words = (uint32_t)(sampler->buffer_size - 2) * (100 - pre_percent) / 100;
+    if (post_words == 0) post_words = 1;
+    trigger_post_samples = post_words * (32 / sampler->channel_count);
+
+    // X = post-trigger samples - 1, Y counts the pre-trigger samples down from all ones
+    pio_sm_put(sampler->pio, sm, trigger_post_samples - 1);
+    pio_sm_exec(sampler->pio, sm, pio_encode_pull(false, false));
+    pio_sm_exec(sampler->pio, sm, pio_encode_mov(pio_x, pio_osr));
+    pio_sm_exec(sampler->pio, sm, pio_encode_mov_not(pio_y, pio_null));
+    pio_interrupt_clear(sampler->pio, sm);
+
+    arm_ring(sampler, sm);
+    triggered_capture = true;
+
+    pio_sm_set_enabled(sampler->pio, sm, true);
+    dma_channel_start(dma_channel);
+}
+
+static void end_triggered_capture(sampler_t *sampler) {
+    pio_sm_set_enabled(sampler->pio, sampler->trigger_sm, false);
+    disarm_ring(sampler, sampler->trigger_sm);
+    pio_remove_program(sampler->pio, &trigger_program, trigger_offset);
+    pio_interrupt_clear(sampler->pio, sampler->trigger_sm);
+    triggered_capture = false;
+}
+
+static void reverse_words(uint32_t *words, uint32_t count) {
+    for (uint32_t i = 0, j = count; i + 1 < j; i++, j--) {
+        uint32_t t = words[i];
+        words[i] = words[j - 1];
+        words[j - 1] = t;
+    }
+}
+
+// Rotates the ring in place so that word `start` comes first
+static void rotate_ring(sampler_t *sampler, uint32_t start) {
+    if (start == 0) return;
+    reverse_words(sampler->sample_buffer, start);
+    reverse_words(sampler->sample_buffer + start, sampler->buffer_size - start);
+    reverse_words(sampler->sample_buffer, sampler->buffer_size);
+}
+
+static sampler_block_t *ring_block(sampler_t *sampler, uint32_t words, uint32_t trigger_sample) {
+    sampler_block_t *block = &sampler->blocks[0];
+    block->data = sampler->sample_buffer;
+    // whole groups of interleaved words only
+    block->word_count = words - words % sampler->channel_count;
+    block->seq = ++sampler->block_seq;
+    block->sample_rate = trigger_sample_rate;
+    block->trigger_sample = trigger_sample;
+    block->rle = false;
+    block->clobbered = false;
+    block->state = SAMPLER_BLOCK_BUSY;
+    return block;
+}
+
+sampler_block_t *poll_triggered_capture(sampler_t *sampler) {
+    uint sm = sampler->trigger_sm;
+    if (!triggered_capture || !pio_interrupt_get(sampler->pio, sm)) return NULL;
+
+    // the state machine has stopped after its last push, let the DMA store it
+    while (!pio_sm_is_rx_fifo_empty(sampler->pio, sm))
+        tight_loop_contents();
+    uint32_t end = ring_position(sampler);
+    end_triggered_capture(sampler);
+
+    // the last two words are the partial word and Y, both are dropped
+    uint32_t size = sampler->buffer_size;
+    uint32_t samples_per_word = 32 / sampler->channel_count;
+    uint32_t pre_samples = ~sampler->sample_buffer[(end + size - 1) % size];
+    uint32_t full_words = (pre_samples + trigger_post_samples) / samples_per_word;
+    uint32_t words = full_words < size - 2 ? full_words : size - 2;
+
+    rotate_ring(sampler, (end + 2 * size - 2 - words) % size);
+    return ring_block(sampler, words, pre_samples - (full_words - words) * samples_per_word);
+}
+
+sampler_block_t *stop_triggered_capture(sampler_t *sampler) {
+    sampler_block_t *block = poll_triggered_capture(sampler);
+    if (block || !triggered_capture) return block;
+
+    uint sm = sampler->trigger_sm;
+    pio_sm_set_enabled(sampler->pio, sm, false);
+    while (!pio_sm_is_rx_fifo_empty(sampler->pio, sm))
+        tight_loop_contents();
+    uint32_t end = ring_position(sampler);
+    uint32_t words = ring_blocks >= SAMPLER_BLOCKS ? sampler->buffer_size : end;
+    end_triggered_capture(sampler);
+
+    rotate_ring(sampler, (end + sampler->buffer_size - words) % sampler->buffer_size);
+    return ring_block(sampler, words, SAMPLER_NO_TRIGGER);
+}
+
+// returns the oldest filled block, or NULL when none is ready yet
+sampler_block_t *sampler_get_block(sampler_t *sampler) {
+    sampler_block_t *oldest = NULL;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (uint i = 0; i < SAMPLER_BLOCKS; i++) {
+        sampler_block_t *block = &sampler->blocks[i];
+        if (block->state == SAMPLER_BLOCK_READY && (!oldest || (int32_t)(block->seq - oldest->seq) < 0)) {
+            oldest = block;
+        }
+    }
+    if (oldest) oldest->state = SAMPLER_BLOCK_BUSY;
+    restore_interrupts(irq_state);
+
+    return oldest;
+}
+
+// a ring channel still running inside the block
+static bool ring_writing(sampler_t *sampler, const sampler_block_t *block) {
+    const int channels[2] = {dma_channel, dma_channel_chained};
+
+    if (ring_sampler != sampler) return false;
+    for (uint i = 0; i < 2; i++) {
+        if (!dma_channel_is_busy(channels[i])) continue;
+        const uint32_t *write = (const uint32_t *)dma_channel_hw_addr(channels[i])->write_addr;
+        if (write >= block->data && write < block->data + block->word_count) return true;
+    }
+    return false;
+}
+
+bool sampler_release_block(sampler_t *sampler, sampler_block_t *block) {
+    // the interrupt marks a block once the ring is in it, a refill started since is seen on the channels
+    bool intact = !block->clobbered && !ring_writing(sampler, block);
+    block->clobbered = false;
+    block->state = SAMPLER_BLOCK_FREE;
+    return intact;
+}
+
+void start_rle_capture(sampler_t *sampler) {
+    uint sm = sampler->trigger_sm;
+
+    rle_offset = pio_add_program(sampler->pio, &sampler_rle_program);
+    pio_sm_config c = sampler_rle_program_get_default_config(rle_offset);
+    sm_config_set_jmp_pin(&c, sampler->pin);
+    sm_config_set_in_shift(&c, true, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv(&c, sampler->clkdiv);
+    pio_sm_init(sampler->pio, sm, rle_offset, &c);
+    pio_sm_exec(sampler->pio, sm, pio_encode_set(pio_y, 1));
+    pio_sm_exec(sampler->pio, sm, pio_encode_mov_not(pio_x, pio_null));
+
+    capture_complete = false;
+    dma_channel_config config = sampler_dma_config(sampler, sm, dma_channel, dma_channel);
+    dma_channel_configure(
+        dma_channel,
+        &config,
+        sampler->sample_buffer,
+        &sampler->pio->rxf[sm],
+        sampler->buffer_size,
+        false
+    );
+    rle_capture = true;
+
+    pio_sm_set_enabled(sampler->pio, sm, true);
+    dma_channel_start(dma_channel);
+}
+
+static sampler_block_t *end_rle_capture(sampler_t *sampler, uint32_t words) {
+    pio_remove_program(sampler->pio, &sampler_rle_program, rle_offset);
+    rle_capture = false;
+
+    // the program starts at `low` whatever the pin: the first word is a partial
+    // run, or an empty low one when the pin was already high
+    sampler_block_t *block = &sampler->blocks[0];
+    block->data = sampler->sample_buffer + (words > 0);
+    block->word_count = words - (words > 0);
+    block->seq = ++sampler->block_seq;
+    // one sample per state machine cycle, the same rate as the free-running program
+    block->sample_rate = sampler->sample_rate;
+    block->trigger_sample = SAMPLER_NO_TRIGGER;
+    block->rle = true;
+    block->clobbered = false;
+    block->state = SAMPLER_BLOCK_BUSY;
+    return block;
+}
+
+sampler_block_t *poll_rle_capture(sampler_t *sampler) {
+    if (!rle_capture || !capture_complete) return NULL;
+
+    pio_sm_set_enabled(sampler->pio, sampler->trigger_sm, false);
+    return end_rle_capture(sampler, sampler->buffer_size);
+}
+
+sampler_block_t *stop_rle_capture(sampler_t *sampler) {
+    if (!rle_capture) return NULL;
+
+    uint sm = sampler->trigger_sm;
+    pio_sm_set_enabled(sampler->pio, sm, false);
+    uint32_t words = sampler->buffer_size;
     if (!capture_complete) {
+        // the DMA still takes what the FIFO holds, then the remaining count tells the runs stored
+        while (!pio_sm_is_rx_fifo_empty(sampler->pio, sm))
+            tight_loop_contents();
+        words -= dma_channel_hw_addr(dma_channel)->transfer_count;
         capture_complete = true;
         dma_channel_abort(dma_channel);
         dma_channel_acknowledge_irq0(dma_channel);
     }
-}
\ No newline at end of file
+    return end_rle_capture(sampler, words);
+}
+
+double sampler_max_sample_rate(const sampler_t *sampler) {
+    return (double)clock_get_hz(clk_sys) / sampler_min_clkdiv(sampler);
+}
+
+double sampler_measure_sample_rate(sampler_t *sampler) {
+    uint64_t t0 = time_us_64();
+    start_capture(sampler);
+    wait_capture_blocking(sampler);
+    uint64_t elapsed_us = time_us_64() - t0;
+    stop_capture(sampler);
+
+    uint64_t samples = (uint64_t)sampler->buffer_size * (32 / sampler->channel_count);
+    return elapsed_us ? samples * 1000000.0 / elapsed_us : 0.0;
+}
+
+double sampler_set_sample_rate(sampler_t *sampler, double sample_rate) {
+    double clk = (double)clock_get_hz(clk_sys);
+
+    // the divider is 16.8 fixed point
+    double div = clk / sample_rate;
+    if (div < sampler_min_clkdiv(sampler)) div = sampler_min_clkdiv(sampler);
+    if (div > 65535.0) div = 65535.0;
+    uint32_t div_q8 = (uint32_t)(div * 256.0 + 0.5);
+
+    bool running = continuous_capture;
+    bool triggered = triggered_capture;
+    if (running) stop_continuous_capture(sampler);
+    if (triggered) end_triggered_capture(sampler);
+
+    pio_sm_set_clkdiv_int_frac(sampler->pio, 0, div_q8 >> 8, div_q8 & 0xFF);
+    pio_sm_clkdiv_restart(sampler->pio, 0);
+    sampler->clkdiv = div_q8 / 256.0f;
+    sampler->sample_rate = clk * 256.0 / (double)div_q8;
+
+    if (running) start_continuous_capture(sampler);
+    if (triggered) start_triggered_capture(sampler, &active_trigger);
+    return sampler->sample_rate;
+}
+
+double sampler_autorange_rate(const sampler_t *sampler, double block_rate, uint32_t transitions, uint32_t total_samples,
+                              uint32_t target_periods, uint32_t max_capture_ms) {
+    double capture_samples = (double)sampler->buffer_size * 32.0 / sampler->channel_count;
+    double max_rate = sampler_max_sample_rate(sampler);
+    double min_rate = capture_samples * 1000.0 / max_capture_ms;
+    double rate;
+
+    if (transitions < 2 || total_samples == 0) {
+        // nothing to measure: probe with a 16 times longer window
+        rate = block_rate / 16.0;
+    } else {
+        double freq = (transitions / 2.0) * block_rate / total_samples;
+        rate = freq * capture_samples / target_periods;
+    }
+
+    if (rate > max_rate) rate = max_rate;
+    if (rate < min_rate) rate = min_rate;
+    return rate;
+}
@@ -5,17 +5,152 @@
 #include <hardware/pio.h>
 #include <hardware/clocks.h>
 #include <hardware/dma.h>
+#include <hardware/vreg.h>
+
+// Continuous capture splits the sample buffer into blocks filled in turn, two
+// chained DMA channels take every other block and raise an IRQ per block, so
+// the consumer can start on the first block while the rest are still filling
+#define SAMPLER_BLOCKS 16
+
+// Fastest state machine clock divider without a profile, one sample per cycle
+#define SAMPLER_MIN_CLKDIV 4.0f
+
+// clk_peri above this runs from the 48 MHz USB PLL instead of the system clock
+#define SAMPLER_PERI_MAX_HZ 133000000u
+
+// Timebase profile: the system clock, the core voltage it needs and the
+// fastest state machine divider go together. The DMA budget keeps the sample
+// words to a share of the bus, so with more channels the divider may have to
+// stay above min_clkdiv.
+typedef struct {
+    const char *name;
+    uint32_t sys_hz;
+    enum vreg_voltage vreg;
+    uint8_t min_clkdiv;             // 1 takes a sample of every channel each system clock cycle
+    uint8_t dma_cycles_per_word;    // system clock cycles per sample word at least
+} sampler_profile_t;
+
+enum {
+    SAMPLER_PROFILE_STANDARD = 0,   // 128 MHz, 32 MS/s
+    SAMPLER_PROFILE_FAST,           // 200 MHz, 200 MS/s
+    SAMPLER_PROFILE_TURBO,          // 250 MHz, 250 MS/s
+    SAMPLER_PROFILE_COUNT
+};
+
+extern const sampler_profile_t sampler_profiles[SAMPLER_PROFILE_COUNT];
+
+// The trigger programs take 4 cycles per sample and run with a 4 times smaller divider
+#define SAMPLER_TRIGGER_CYCLES 4
+
+#define SAMPLER_NO_TRIGGER 0xFFFFFFFFu
+
+typedef enum {
+    SAMPLER_TRIGGER_RISING = 0,
+    SAMPLER_TRIGGER_FALLING,
+    SAMPLER_TRIGGER_HIGH,
+    SAMPLER_TRIGGER_LOW
+} sampler_trigger_mode_t;
 
 typedef struct {
-    uint pin; // signal pin
+    sampler_trigger_mode_t mode;
+    uint8_t channel;        // channel whose pin is watched
+    uint8_t pre_percent;    // share of the buffer kept before the trigger
+} sampler_trigger_t;
+
+typedef enum {
+    SAMPLER_BLOCK_FREE = 0, // owned by the DMA
+    SAMPLER_BLOCK_READY,    // filled, waiting for the consumer
+    SAMPLER_BLOCK_BUSY      // taken by the consumer
+} sampler_block_state_t;
+
+typedef struct {
+    uint32_t *data;
+    uint32_t word_count;
+    uint32_t seq;           // number of the fill, increments across blocks
+    double sample_rate;     // sample rate the block was filled with
+    uint32_t trigger_sample; // per channel sample of the trigger, SAMPLER_NO_TRIGGER if free-running
+    bool rle;               // run-length words from the RLE program, sample_rate counts its cycles
+    volatile bool clobbered; // the ring came round and refilled it while the consumer held it
+    volatile sampler_block_state_t state;
+} sampler_block_t;
+
+typedef struct {
+    uint pin; // signal pin, first of channel_count consecutive pins
+    uint8_t channel_count; // 1, 2, 4 or 8
     PIO pio;
+    uint trigger_sm;        // runs the trigger and RLE programs
     uint32_t *sample_buffer;
     const uint16_t buffer_size;
+    const sampler_profile_t *profile; // set by sampler_apply_profile, NULL keeps SAMPLER_MIN_CLKDIV
+    float clkdiv;
+    double sample_rate;
+    sampler_block_t blocks[SAMPLER_BLOCKS];
+    volatile uint32_t block_seq;
+    volatile uint32_t overruns; // blocks refilled before the consumer took or released them
 } sampler_t;
 
+// Switches to the voltage and system clock of the profile, false if the clock
+// cannot be reached. Meant for boot, before any peripheral is set up: the
+// UART, I2C and WS2812 dividers are derived from the clocks it leaves behind.
+bool sampler_apply_profile(sampler_t *sampler, const sampler_profile_t *profile);
 double setup_sampler(sampler_t *sampler);
+// One-shot capture of the whole buffer timed with the microsecond timer, which
+// runs from the crystal and not from the system clock; returns the sample rate
+// measured. A DMA that cannot keep up stalls the state machine and shows here.
+double sampler_measure_sample_rate(sampler_t *sampler);
 void start_capture(sampler_t *sampler);
+// One-shot capture of the first word_count words of the buffer; poll_capture
+// returns the block once they are filled
+void start_capture_words(sampler_t *sampler, uint32_t word_count);
+sampler_block_t *poll_capture(sampler_t *sampler);
 void wait_capture_blocking(sampler_t *sampler);
 void stop_capture(sampler_t *sampler);
 
+// Gapless capture: two chained DMA channels fill the blocks in turn while the
+// state machine keeps running; a channel is pointed two blocks further on as
+// it finishes one. Filled blocks are taken with sampler_get_block
+// and must be handed back with sampler_release_block before they come round again;
+// a block held too long is overwritten and counted as an overrun.
+void start_continuous_capture(sampler_t *sampler);
+void stop_continuous_capture(sampler_t *sampler);
+sampler_block_t *sampler_get_block(sampler_t *sampler);
+// Hands the block back, false if the ring refilled it while it was held: what
+// was read from it since sampler_get_block is not to be trusted
+bool sampler_release_block(sampler_t *sampler, sampler_block_t *block);
+
+// Triggered capture: the trigger state machine samples into the buffer used
+// as a ring until the trigger fires, then takes the post-trigger share and
+// stops. poll_triggered_capture returns NULL until then; the block it returns
+// covers the buffer rotated into time order with the trigger at
+// block->trigger_sample. stop_triggered_capture gives up waiting and returns
+// the newest samples without a trigger. Release the block as usual.
+void start_triggered_capture(sampler_t *sampler, const sampler_trigger_t *trigger);
+sampler_block_t *poll_triggered_capture(sampler_t *sampler);
+sampler_block_t *stop_triggered_capture(sampler_t *sampler);
+
+// Run-length capture of channel 0: one word per run (see sampler_rle in
+// sampler.pio) at the resolution of the state machine clock, so the buffer
+// lasts as long as the signal takes for buffer_size runs. poll_rle_capture
+// returns the block once the buffer is full, stop_rle_capture ends early
+// with the runs captured so far. Decode with edge_list_append_rle.
+void start_rle_capture(sampler_t *sampler);
+sampler_block_t *poll_rle_capture(sampler_t *sampler);
+sampler_block_t *stop_rle_capture(sampler_t *sampler);
+
+// Timebase: reprograms the state machine clock divider (restarting a running
+// continuous or triggered capture) and returns the achieved sample rate
+double sampler_set_sample_rate(sampler_t *sampler, double sample_rate);
+// Fastest divider of the profile within its DMA budget for the channel count
+float sampler_min_clkdiv(const sampler_t *sampler);
+double sampler_max_sample_rate(const sampler_t *sampler);
+
+// Auto-ranging: sample rate for the next capture so that the whole buffer
+// holds about target_periods periods, estimated from the transitions of the
+// last capture, however many blocks it took, at the rate its blocks were
+// sampled with (a triggered capture runs slower than the free-running rate in
+// the clkdiv 1 profiles). Without transitions the rate steps down to probe for
+// slower signals; the whole buffer never takes longer than max_capture_ms.
+double sampler_autorange_rate(const sampler_t *sampler, double block_rate, uint32_t transitions, uint32_t total_samples,
+                              uint32_t target_periods, uint32_t max_capture_ms);
+
 #endif // !SAMPLER_H
@@ -1,20 +1,33 @@
 #include "ssd1306.h"
 #include "font.h"
 #include "string.h"
+#include "hardware/dma.h"
+
+bool ssd1306_write_command(ssd1306_t *disp, uint8_t cmd) {
+    // a panel that did not answer is not talked to again
+    if (!disp->present) return false;
+    while (ssd1306_busy(disp))
+        tight_loop_contents();
 
-void ssd1306_write_command(ssd1306_t *disp, uint8_t cmd) {
     uint8_t buf[2] = {0x00, cmd};
-    i2c_write_blocking(disp->i2c_port, disp->address, buf, 2, false);
+    if (i2c_write_blocking(disp->i2c_port, disp->address, buf, 2, false) == PICO_ERROR_GENERIC) {
+        disp->present = false;
+        return false;
+    }
+    return true;
 }
 
-void ssd1306_init(ssd1306_t *disp) {
+bool ssd1306_init(ssd1306_t *disp) {
 
     gpio_init(disp->SDA);
     gpio_init(disp->SCL);
     gpio_set_dir(disp->SDA, GPIO_IN);
     gpio_set_dir(disp->SCL, GPIO_IN);
     
-    i2c_init(disp->i2c_port, 400000);
+    i2c_init(disp->i2c_port, disp->fast_mode_plus ? 1000000 : 400000);
+    disp->dma_channel = dma_claim_unused_channel(true);
+    disp->flush_pending = false;
+    disp->present = true;
     
     gpio_set_function(disp->SDA, GPIO_FUNC_I2C);
     gpio_set_function(disp->SCL, GPIO_FUNC_I2C);
@@ -71,6 +84,8 @@ void ssd1306_init(ssd1306_t *disp) {
     for (int i = 0; i < sizeof(disp->buffer); i++) {
         disp->buffer[i] = 0;
     }
+    disp->shown_valid = false;
+    return disp->present;
 }
 
 void ssd1306_clear(ssd1306_t *disp) {
@@ -85,16 +100,91 @@ void ssd1306_fill(ssd1306_t *disp, uint8_t data) {
     }
 }
 
-void ssd1306_show(ssd1306_t *disp) {
-    for (uint8_t page = 0; page < 8; page++) {
-        ssd1306_write_command(disp, 0xB0 + page);
-        ssd1306_write_command(disp, 0x00);
-        ssd1306_write_command(disp, 0x10);
-        
-        uint8_t buf[129] = {0x40};
-        memcpy(buf + 1, &disp->buffer[page * 128], 128);
-        i2c_write_blocking(disp->i2c_port, disp->address, buf, 129, false);
+bool ssd1306_busy(ssd1306_t *disp) {
+    if (dma_channel_is_busy(disp->dma_channel)) return true;
+    // the DMA is done once the last word is in the FIFO, the bus needs a while longer
+    uint32_t status = disp->i2c_port->hw->status;
+    return !(status & I2C_IC_STATUS_TFE_BITS) || (status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+// Encodes one page update as IC_DATA_CMD words: a STOP after the commands and
+// after the data makes the controller issue two transfers back to back.
+static uint16_t *encode_page(ssd1306_t *disp, uint16_t *tx, uint8_t page) {
+    *tx++ = 0x00;
+    *tx++ = 0xB0 + page;
+    *tx++ = 0x00;
+    *tx++ = 0x10 | I2C_IC_DATA_CMD_STOP_BITS;
+
+    *tx++ = 0x40;
+    const uint8_t *data = &disp->buffer[page * 128];
+    for (int i = 0; i < 127; i++) {
+        *tx++ = data[i];
     }
+    *tx++ = data[127] | I2C_IC_DATA_CMD_STOP_BITS;
+    return tx;
+}
+
+// A NACK aborts the flush and the controller drops the rest of it, so the
+// panel no longer shows what `shown` says: every page goes out again.
+static bool flush_aborted(ssd1306_t *disp) {
+    i2c_hw_t *hw = disp->i2c_port->hw;
+    if (!(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)) return false;
+    (void)hw->clr_tx_abrt;
+    disp->shown_valid = false;
+    disp->aborts++;
+    return true;
+}
+
+bool ssd1306_show_async(ssd1306_t *disp) {
+    if (!disp->present) return true;
+    if (ssd1306_busy(disp)) {
+        disp->flush_pending = true;
+        return false;
+    }
+    disp->flush_pending = false;
+    flush_aborted(disp);
+
+    uint16_t *tx = disp->tx;
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        uint8_t *shown = &disp->shown[page * 128];
+        const uint8_t *data = &disp->buffer[page * 128];
+        if (disp->shown_valid && memcmp(shown, data, 128) == 0) continue;
+
+        memcpy(shown, data, 128);
+        tx = encode_page(disp, tx, page);
+    }
+    disp->shown_valid = true;
+
+    uint32_t words = tx - disp->tx;
+    if (words == 0) return true;
+
+    i2c_hw_t *hw = disp->i2c_port->hw;
+    hw->enable = 0;
+    hw->tar = disp->address;
+    hw->enable = 1;
+    (void)hw->clr_tx_abrt;
+
+    // 16-bit writes are replicated across the 32-bit register, the upper half of IC_DATA_CMD is reserved
+    dma_channel_config config = dma_channel_get_default_config(disp->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(disp->i2c_port, true));
+    dma_channel_configure(disp->dma_channel, &config, &hw->data_cmd, disp->tx, words, true);
+    return true;
+}
+
+void ssd1306_poll(ssd1306_t *disp) {
+    if (disp->flush_pending || (disp->present && !ssd1306_busy(disp) && flush_aborted(disp))) {
+        ssd1306_show_async(disp);
+    }
+}
+
+void ssd1306_show(ssd1306_t *disp) {
+    while (!ssd1306_show_async(disp))
+        tight_loop_contents();
+    while (ssd1306_busy(disp))
+        tight_loop_contents();
 }
 
 void ssd1306_draw_pixel(ssd1306_t *disp, uint8_t x, uint8_t y, bool on) {
@@ -108,29 +198,94 @@ void ssd1306_draw_pixel(ssd1306_t *disp, uint8_t x, uint8_t y, bool on) {
     }
 }
 
+// Glyphs pre-scaled to 12x16 in panel layout: 12 columns of the upper page
+// followed by 12 columns of the lower page, built once from the 5x8 font
+#define GLYPH_COUNT 96
+static uint8_t glyphs[GLYPH_COUNT][2][FONT_WIDTH];
+static bool glyphs_ready = false;
+
+// Doubles every bit of a font column: row r becomes rows 2r and 2r+1
+static uint16_t scale_column(uint8_t line) {
+    uint16_t v = line;
+    v = (v | (v << 4)) & 0x0F0F;
+    v = (v | (v << 2)) & 0x3333;
+    v = (v | (v << 1)) & 0x5555;
+    return v | (v << 1);
+}
+
+static void build_glyphs(void) {
+    // horizontal scale = 2 (5 -> 10), 1px padding left and right => 12 width
+    const uint8_t left_padding = 1;
+    memset(glyphs, 0, sizeof(glyphs));
+    for (int c = 0; c < GLYPH_COUNT; c++) {
+        for (uint8_t col = 0; col < 5; col++) {
+            uint16_t v = scale_column(font[c * 5 + col]);
+            for (uint8_t dx = 0; dx < 2; dx++) {
+                glyphs[c][0][left_padding + col * 2 + dx] = v & 0xFF;
+                glyphs[c][1][left_padding + col * 2 + dx] = v >> 8;
+            }
+        }
+    }
+    glyphs_ready = true;
+}
+
 void ssd1306_draw_char(ssd1306_t *disp, uint8_t x, uint8_t y, char c) {
     if (c < 32 || c > 127) return;
+    if (y >= disp->height) return;
+    if (!glyphs_ready) build_glyphs();
 
-    // Render 5x8 source glyphs scaled to 12x16 characters:
-    // - horizontal scale = 2 (5 -> 10), add 1px padding left and right => 12 width
-    // - vertical scale = 2 (8 -> 16)
-    const uint8_t left_padding = 1;
-    for (uint8_t col = 0; col < 5; col++) {
-        uint8_t line = font[(c - 32) * 5 + col];
-        for (uint8_t row = 0; row < 8; row++) {
-            if (line & 0x1) {
-                // draw 2x2 block for each source pixel
-                uint8_t sx = x + left_padding + col * 2;
-                uint8_t sy = y + row * 2;
-                ssd1306_draw_pixel(disp, sx,     sy,     true);
-                ssd1306_draw_pixel(disp, sx + 1, sy,     true);
-                ssd1306_draw_pixel(disp, sx,     sy + 1, true);
-                ssd1306_draw_pixel(disp, sx + 1, sy + 1, true);            }
-            line >>= 1;
+    const uint8_t (*glyph)[FONT_WIDTH] = glyphs[c - 32];
+    uint8_t page = y >> 3;
+    uint8_t shift = y & 7;
+    uint8_t pages = disp->height >> 3;
+
+    // a 16 pixel high glyph covers 2 pages when aligned, 3 otherwise
+    for (uint8_t col = 0; col < FONT_WIDTH; col++) {
+        if (x + col >= disp->width) break;
+        uint32_t v = ((uint32_t)glyph[0][col] | ((uint32_t)glyph[1][col] << 8)) << shift;
+        uint8_t *dst = &disp->buffer[page * disp->width + x + col];
+        for (uint8_t p = page; v && p < pages; p++, v >>= 8, dst += disp->width) {
+            *dst |= v & 0xFF;
         }
     }
 }
 
+void ssd1306_draw_hspan(ssd1306_t *disp, uint8_t x, uint8_t y, uint16_t w) {
+    if (x >= disp->width || y >= disp->height) return;
+    if (w > disp->width - x) w = disp->width - x;
+
+    uint8_t mask = 1 << (y & 7);
+    uint8_t *dst = &disp->buffer[(y >> 3) * disp->width + x];
+    while (w--) {
+        *dst++ |= mask;
+    }
+}
+
+void ssd1306_draw_vspan(ssd1306_t *disp, uint8_t x, uint8_t y, uint16_t h) {
+    if (x >= disp->width || y >= disp->height) return;
+    if (h > disp->height - y) h = disp->height - y;
+
+    uint8_t *dst = &disp->buffer[(y >> 3) * disp->width + x];
+    uint8_t bit = y & 7;
+    while (h) {
+        // as many rows as fit into the current page, whole bytes in the middle
+        uint8_t rows = 8 - bit;
+        if (rows > h) rows = h;
+        *dst |= (uint8_t)(((1u << rows) - 1) << bit);
+        h -= rows;
+        bit = 0;
+        dst += disp->width;
+    }
+}
+
+void ssd1306_draw_rect(ssd1306_t *disp, uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool on) {
+    if (!on || w == 0 || h == 0) return;
+    ssd1306_draw_hspan(disp, x, y, w);
+    ssd1306_draw_hspan(disp, x, y + h - 1, w);
+    ssd1306_draw_vspan(disp, x, y, h);
+    ssd1306_draw_vspan(disp, x + w - 1, y, h);
+}
+
 void ssd_draw_fullpixel(ssd1306_t *disp, uint8_t x, uint8_t y, bool on, int size)
 {
     uint8_t sx = x;
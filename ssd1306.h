@@ -4,6 +4,10 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 
+#define SSD1306_PAGES 8
+// I2C words per page: command transfer (control byte + 3 commands) and data transfer (control byte + 128 bytes)
+#define SSD1306_PAGE_TX_WORDS (4 + 129)
+
 typedef struct {
     i2c_inst_t *i2c_port;
     uint SCL;
@@ -12,16 +16,35 @@ typedef struct {
     uint8_t width;
     uint8_t height;
     bool external_vcc;
-    uint8_t buffer[1024]; // 128x64/8
+    bool fast_mode_plus; // 1 MHz I2C instead of 400 kHz
+    uint8_t buffer[1024]; // 128x64/8, frame being drawn
+    uint8_t shown[1024];  // frame last sent to the panel
+    bool shown_valid;
+    bool flush_pending;   // a flush was requested while the previous one was still running
+    bool present;         // answered every command of the init sequence, nothing is sent otherwise
+    uint32_t aborts;      // flushes cut short by a NACK, each one resent whole
+    int dma_channel;
+    uint16_t tx[SSD1306_PAGES * SSD1306_PAGE_TX_WORDS]; // IC_DATA_CMD words of the flush in flight
 } ssd1306_t;
 
-void ssd1306_init(ssd1306_t *disp);
+// Returns false when the panel does not acknowledge, drawing then goes nowhere
+bool ssd1306_init(ssd1306_t *disp);
 void ssd1306_clear(ssd1306_t *disp);
 void ssd1306_fill(ssd1306_t *disp, uint8_t data);
 void ssd1306_show(ssd1306_t *disp);
+// Non-blocking flush: changed pages are queued to the I2C controller by DMA,
+// drawing into the buffer may continue right away. Returns false when the
+// previous flush is still running, the frame is then sent by ssd1306_poll,
+// which also resends a frame whose flush the panel did not acknowledge.
+bool ssd1306_show_async(ssd1306_t *disp);
+bool ssd1306_busy(ssd1306_t *disp);
+void ssd1306_poll(ssd1306_t *disp);
 void ssd1306_draw_pixel(ssd1306_t *disp, uint8_t x, uint8_t y, bool on);
 void ssd_draw_fullpixel(ssd1306_t *disp, uint8_t x, uint8_t y, bool on, int size);
 void ssd1306_draw_string(ssd1306_t *disp, uint8_t x, uint8_t y, const char *str);
+// Set-only spans, written a whole byte (horizontal) or page (vertical) at a time
+void ssd1306_draw_hspan(ssd1306_t *disp, uint8_t x, uint8_t y, uint16_t w);
+void ssd1306_draw_vspan(ssd1306_t *disp, uint8_t x, uint8_t y, uint16_t h);
 void ssd1306_draw_line(ssd1306_t *disp, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool on);
 void ssd1306_draw_rect(ssd1306_t *disp, uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool on);
 
@@ -0,0 +1,219 @@
+#include "sump.h"
+
+#include <string.h>
+#include "tusb.h"
+
+#define SUMP_DEVICE_NAME "ztester"
+
+static uint32_t capacity_samples(const sampler_t *sampler) {
+    return (uint32_t)sampler->buffer_size * (32 / sampler->channel_count);
+}
+
+static void sump_abort(sump_t *sump) {
+    if (sump->state == SUMP_CAPTURING) {
+        if (sump->triggered) {
+            sump->block = stop_triggered_capture(sump->sampler);
+        } else {
+            stop_capture(sump->sampler);
+        }
+    }
+    if (sump->block) {
+        sampler_release_block(sump->sampler, sump->block);
+        sump->block = NULL;
+    }
+    sump->state = SUMP_IDLE;
+}
+
+void sump_init(sump_t *sump, sampler_t *sampler) {
+    memset(sump, 0, sizeof(*sump));
+    sump->sampler = sampler;
+    sump->read_count = 4096;
+    sump->delay_count = 4096;
+}
+
+static void write_bytes(const void *data, uint32_t length) {
+    tud_cdc_write(data, length);
+    tud_cdc_write_flush();
+}
+
+static uint32_t put_be32(uint8_t *out, uint8_t key, uint32_t value) {
+    out[0] = key;
+    out[1] = value >> 24;
+    out[2] = value >> 16;
+    out[3] = value >> 8;
+    out[4] = value;
+    return 5;
+}
+
+static void send_metadata(sump_t *sump) {
+    uint8_t meta[48];
+    uint32_t n = 0;
+
+    meta[n++] = SUMP_META_NAME;
+    memcpy(&meta[n], SUMP_DEVICE_NAME, sizeof(SUMP_DEVICE_NAME));
+    n += sizeof(SUMP_DEVICE_NAME);
+    n += put_be32(&meta[n], SUMP_META_SAMPLE_MEMORY, capacity_samples(sump->sampler));
+    n += put_be32(&meta[n], SUMP_META_MAX_RATE, (uint32_t)sampler_max_sample_rate(sump->sampler));
+    meta[n++] = SUMP_META_PROBES;
+    meta[n++] = sump->sampler->channel_count;
+    meta[n++] = SUMP_META_PROTOCOL;
+    meta[n++] = 2;
+    meta[n++] = SUMP_META_END;
+    write_bytes(meta, n);
+}
+
+static void handle_command(sump_t *sump, const uint8_t *cmd) {
+    uint32_t arg = cmd[1] | (cmd[2] << 8) | (cmd[3] << 16) | ((uint32_t)cmd[4] << 24);
+
+    switch (cmd[0]) {
+        case SUMP_CMD_RESET:
+            sump_abort(sump);
+            sump->xoff = false;
+            break;
+        case SUMP_CMD_RUN:
+            if (sump->state == SUMP_IDLE) sump->state = SUMP_ARMED;
+            break;
+        case SUMP_CMD_ID:
+            write_bytes(SUMP_ID, 4);
+            break;
+        case SUMP_CMD_METADATA:
+            send_metadata(sump);
+            break;
+        case SUMP_CMD_XON:
+            sump->xoff = false;
+            break;
+        case SUMP_CMD_XOFF:
+            sump->xoff = true;
+            break;
+        case SUMP_CMD_DIVIDER:
+            sump->divider = arg & 0xFFFFFF;
+            break;
+        case SUMP_CMD_READ_DELAY:
+            sump->read_count = ((arg & 0xFFFF) + 1) * 4;
+            sump->delay_count = ((arg >> 16) + 1) * 4;
+            break;
+        case SUMP_CMD_DELAY_COUNT:
+            sump->delay_count = (arg + 1) * 4;
+            break;
+        case SUMP_CMD_READ_COUNT:
+            sump->read_count = (arg + 1) * 4;
+            break;
+        case SUMP_CMD_FLAGS:
+            sump->flags = arg & 0xFF;
+            break;
+        case SUMP_CMD_TRIGGER_MASK:
+            sump->trigger_mask = arg;
+            break;
+        case SUMP_CMD_TRIGGER_VALUE:
+            sump->trigger_value = arg;
+            break;
+        default:
+            // trigger configuration and the further stages: stage 0 always starts the capture
+            break;
+    }
+}
+
+static void parse_byte(sump_t *sump, uint8_t byte) {
+    sump->cmd[sump->cmd_length++] = byte;
+    if (!SUMP_CMD_IS_LONG(sump->cmd[0]) || sump->cmd_length == SUMP_CMD_LENGTH) {
+        handle_command(sump, sump->cmd);
+        sump->cmd_length = 0;
+    }
+}
+
+// Trigger stage 0 maps to a level trigger on the lowest channel of the mask,
+// the remaining bits of the pattern are not matched.
+void sump_start(sump_t *sump) {
+    sampler_t *sampler = sump->sampler;
+    uint32_t capacity = capacity_samples(sampler);
+
+    if (sump->read_count > capacity) sump->read_count = capacity;
+    if (sump->delay_count > sump->read_count) sump->delay_count = sump->read_count;
+    sampler_set_sample_rate(sampler, (double)SUMP_CLOCK_HZ / (sump->divider + 1));
+
+    uint32_t mask = sump->trigger_mask & ((1u << sampler->channel_count) - 1);
+    sump->triggered = mask != 0;
+    if (sump->triggered) {
+        uint8_t channel = 0;
+        while (!(mask & (1u << channel))) channel++;
+
+        sampler_trigger_t trigger = {
+            .mode = (sump->trigger_value & (1u << channel)) ? SAMPLER_TRIGGER_HIGH : SAMPLER_TRIGGER_LOW,
+            .channel = channel,
+            .pre_percent = 100 - (uint8_t)(((uint64_t)sump->delay_count * 100 + capacity - 1) / capacity)
+        };
+        start_triggered_capture(sampler, &trigger);
+    } else {
+        uint32_t samples_per_word = 32 / sampler->channel_count;
+        start_capture_words(sampler, (sump->read_count + samples_per_word - 1) / samples_per_word);
+    }
+    sump->state = SUMP_CAPTURING;
+}
+
+static uint8_t sample_at(const sump_t *sump, int64_t sample) {
+    const sampler_t *sampler = sump->sampler;
+    uint32_t samples_per_word = 32 / sampler->channel_count;
+
+    if (sample < 0 || sample >= (int64_t)sump->block->word_count * samples_per_word) return 0;
+    uint32_t word = sump->block->data[sample / samples_per_word];
+    return (word >> ((sample % samples_per_word) * sampler->channel_count)) & ((1u << sampler->channel_count) - 1);
+}
+
+// Samples go out newest first, one byte per enabled group of 8 probes;
+// only group 0 carries channels
+static void send_samples(sump_t *sump) {
+    uint8_t enabled = ~sump->flags >> SUMP_FLAG_GROUPS_SHIFT;
+    uint8_t groups = 0;
+    for (uint8_t g = 0; g < SUMP_GROUPS; g++) {
+        if (enabled & (1u << g)) groups++;
+    }
+
+    uint8_t chunk[64];
+    uint32_t room = tud_cdc_write_available();
+    while (!sump->xoff && groups && sump->sent < sump->read_count && room >= groups) {
+        uint32_t n = 0;
+        while (sump->sent < sump->read_count && n + groups <= sizeof(chunk) && n + groups <= room) {
+            uint8_t value = sample_at(sump, sump->first_sample + (int64_t)(sump->read_count - 1 - sump->sent));
+            for (uint8_t g = 0; g < SUMP_GROUPS; g++) {
+                if (enabled & (1u << g)) chunk[n++] = g == 0 ? value : 0;
+            }
+            sump->sent++;
+        }
+        tud_cdc_write(chunk, n);
+        room -= n;
+    }
+    tud_cdc_write_flush();
+
+    if (!groups || sump->sent == sump->read_count) {
+        sampler_release_block(sump->sampler, sump->block);
+        sump->block = NULL;
+        sump->state = SUMP_IDLE;
+    }
+}
+
+bool sump_poll(sump_t *sump) {
+    uint8_t buf[32];
+    while (tud_cdc_available()) {
+        uint32_t n = tud_cdc_read(buf, sizeof(buf));
+        for (uint32_t i = 0; i < n; i++) {
+            parse_byte(sump, buf[i]);
+        }
+    }
+
+    if (sump->state == SUMP_CAPTURING) {
+        sump->block = sump->triggered ? poll_triggered_capture(sump->sampler) : poll_capture(sump->sampler);
+        if (sump->block) {
+            // the trigger sits delay_count samples before the end of the window
+            sump->first_sample = 0;
+            if (sump->triggered) {
+                sump->first_sample = (int64_t)sump->block->trigger_sample - (sump->read_count - sump->delay_count);
+            }
+            sump->sent = 0;
+            sump->state = SUMP_SENDING;
+        }
+    }
+    if (sump->state == SUMP_SENDING) {
+        send_samples(sump);
+    }
+    return sump->state != SUMP_IDLE;
+}
@@ -0,0 +1,44 @@
+#ifndef SUMP_H
+#define SUMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sampler.h"
+#include "sump_protocol.h"
+
+typedef enum {
+    SUMP_IDLE = 0,
+    SUMP_ARMED,      // run received, waiting for the sampler to be handed over
+    SUMP_CAPTURING,
+    SUMP_SENDING
+} sump_state_t;
+
+// SUMP session on the USB CDC port. sump_poll never blocks: it parses what
+// the host has sent and moves a capture along, writing samples only as far
+// as the CDC FIFO has room.
+typedef struct {
+    sampler_t *sampler;
+    sump_state_t state;
+    uint8_t cmd[SUMP_CMD_LENGTH];
+    uint8_t cmd_length;
+    uint32_t divider;
+    uint32_t read_count;    // samples sent per run
+    uint32_t delay_count;   // of these, samples after the trigger
+    uint32_t trigger_mask;  // stage 0 only
+    uint32_t trigger_value;
+    uint8_t flags;
+    bool xoff;
+    bool triggered;
+    sampler_block_t *block;
+    int64_t first_sample;   // block sample of the first one sent, before the block with an early trigger
+    uint32_t sent;
+} sump_t;
+
+void sump_init(sump_t *sump, sampler_t *sampler);
+// Returns true while a run is pending or in progress, the caller must leave
+// the sampler alone then. In SUMP_ARMED the caller stops its own capture and
+// calls sump_start once nothing else reads the buffer.
+bool sump_poll(sump_t *sump);
+void sump_start(sump_t *sump);
+
+#endif // !SUMP_H
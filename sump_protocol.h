@@ -0,0 +1,46 @@
+#ifndef SUMP_PROTOCOL_H
+#define SUMP_PROTOCOL_H
+
+// SUMP / OpenBench Logic Sniffer protocol as spoken by PulseView, sigrok and
+// the OLS client. Short commands are one byte, long commands (bit 7 set) are
+// followed by 4 argument bytes, least significant first. Shared with the host
+// client in host/, so no pico-sdk headers here.
+
+// short commands
+#define SUMP_CMD_RESET          0x00
+#define SUMP_CMD_RUN            0x01
+#define SUMP_CMD_ID             0x02
+#define SUMP_CMD_METADATA       0x04
+#define SUMP_CMD_XON            0x11
+#define SUMP_CMD_XOFF           0x13
+
+// long commands
+#define SUMP_CMD_DIVIDER        0x80 // sample rate = SUMP_CLOCK_HZ / (divider + 1), 24 bits
+#define SUMP_CMD_READ_DELAY     0x81 // read count / 4 - 1 in the low half, delay count / 4 - 1 in the high half
+#define SUMP_CMD_FLAGS          0x82
+#define SUMP_CMD_DELAY_COUNT    0x83 // delay count / 4 - 1 as 32 bits, for memories beyond 256K samples
+#define SUMP_CMD_READ_COUNT     0x84 // read count / 4 - 1 as 32 bits
+#define SUMP_CMD_TRIGGER_MASK   0xC0 // stage n at 0xC0 + 4 * n
+#define SUMP_CMD_TRIGGER_VALUE  0xC1
+#define SUMP_CMD_TRIGGER_CONFIG 0xC2
+
+#define SUMP_CMD_IS_LONG(cmd)   ((cmd) & 0x80)
+#define SUMP_CMD_LENGTH         5
+
+#define SUMP_CLOCK_HZ           100000000u
+#define SUMP_ID                 "1ALS"
+
+// flags: bits 2..5 disable the channel groups of 8 probes
+#define SUMP_FLAG_GROUPS_SHIFT  2
+#define SUMP_GROUPS             4
+
+// metadata keys, strings are NUL terminated, 32-bit values big endian
+#define SUMP_META_END           0x00
+#define SUMP_META_NAME          0x01
+#define SUMP_META_FIRMWARE      0x02
+#define SUMP_META_SAMPLE_MEMORY 0x21
+#define SUMP_META_MAX_RATE      0x23
+#define SUMP_META_PROBES        0x40 // followed by one byte
+#define SUMP_META_PROTOCOL      0x41 // followed by one byte
+
+#endif // !SUMP_PROTOCOL_H
@@ -0,0 +1,145 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// Binary measurement records sent over the debug UART instead of the text
+// dump. Every record is COBS encoded and framed by a zero byte on both sides,
+// so text printed at the higher debug levels passes between the frames and
+// a decoder can resynchronise at any zero. Fields are little endian and
+// naturally aligned, the layout is the same on the RP2040 and on a 64-bit
+// host. Shared with the decoder in host/, so no pico-sdk headers here.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_RECORD_CAPTURE 1
+#define TELEMETRY_RECORD_CHANNEL 2
+#define TELEMETRY_RECORD_PULSES  3
+#define TELEMETRY_RECORD_FRAMES  4
+
+#define TELEMETRY_FLAG_ACTIVE    0x01
+#define TELEMETRY_FLAG_TRIGGERED 0x02
+#define TELEMETRY_FLAG_RLE       0x04
+#define TELEMETRY_FLAG_COUNTER   0x08 // freq_mhz comes from a hardware counter
+
+#define TELEMETRY_NO_TRIGGER     0xFFFFFFFFu
+#define TELEMETRY_HISTOGRAM_BINS 16 // PULSE_HISTOGRAM_BINS of the analyzer
+#define TELEMETRY_FRAMES         24
+
+// One per block, channel 0
+typedef struct {
+    uint8_t type;               // TELEMETRY_RECORD_CAPTURE
+    uint8_t flags;
+    uint8_t signal_type;        // signal_type_t
+    uint8_t channel_count;
+    uint32_t capture_id;
+    uint32_t block_seq;
+    uint32_t overruns;
+    uint32_t sample_rate;       // Hz
+    uint32_t total_samples;
+    uint32_t high_count;
+    uint32_t transitions;
+    uint32_t avg_high_pulse_q8; // samples, 24.8 fixed point
+    uint32_t avg_low_pulse_q8;
+    uint32_t duty_bp;           // basis points
+    uint32_t trigger_sample;    // TELEMETRY_NO_TRIGGER when free-running
+    uint64_t freq_mhz;          // displayed frequency in milli-Hz
+    uint64_t counter_freq_mhz;  // reciprocal counter, or the gated edge counter above its range; 0 without a reading
+    uint32_t reduced;           // first 32 reduced runs, LSB first, 1 = high
+    uint32_t reduced_spikes;    // runs of the pattern too short to classify
+} telemetry_capture_t;
+
+// One per further channel of a multi-channel block
+typedef struct {
+    uint8_t type;               // TELEMETRY_RECORD_CHANNEL
+    uint8_t channel;
+    uint16_t reserved;
+    uint32_t capture_id;
+    uint32_t transitions;
+    uint32_t duty_bp;
+    uint64_t freq_mhz;
+} telemetry_channel_t;
+
+// Pulse statistics of channel 0, follows the capture record of an active block.
+// Widths and periods in samples, 0 where there was no complete run.
+typedef struct {
+    uint8_t type;               // TELEMETRY_RECORD_PULSES
+    uint8_t reserved[3];
+    uint32_t capture_id;
+    uint32_t glitches;
+    uint32_t periods;
+    uint32_t period_min;
+    uint32_t period_max;
+    uint32_t period_mean_q8;    // 24.8 fixed point
+    uint32_t period_stddev_q8;
+    uint32_t high_min;
+    uint32_t high_max;
+    uint32_t low_min;
+    uint32_t low_max;
+    uint16_t histogram[TELEMETRY_HISTOGRAM_BINS]; // log2 width bins, saturating
+} telemetry_pulses_t;
+
+// the edge lists ran out of room, frames after the last stored run are missing
+#define TELEMETRY_FRAMES_TRUNCATED 0x01
+
+// Protocol frames decoded from a block, several records when there are more
+typedef struct {
+    uint8_t type;               // TELEMETRY_RECORD_FRAMES
+    uint8_t protocol;           // decode_protocol_t
+    uint8_t count;              // frames used
+    uint8_t flags;              // TELEMETRY_FRAMES_*
+    uint32_t capture_id;
+    uint32_t baud;              // UART bit rate, 0 for the other protocols
+    uint16_t frames[TELEMETRY_FRAMES]; // value | DECODE_FLAG_* << 8
+} telemetry_frames_t;
+
+_Static_assert(sizeof(telemetry_capture_t) == 72, "telemetry_capture_t layout");
+_Static_assert(sizeof(telemetry_channel_t) == 24, "telemetry_channel_t layout");
+_Static_assert(sizeof(telemetry_pulses_t) == 80, "telemetry_pulses_t layout");
+_Static_assert(sizeof(telemetry_frames_t) == 60, "telemetry_frames_t layout");
+
+#define TELEMETRY_MAX_RECORD 80
+// COBS adds one byte per 254 and the frame a zero on each side
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_RECORD + TELEMETRY_MAX_RECORD / 254 + 3)
+
+// COBS: every zero is replaced by the distance to the next one, so the
+// encoded data contains no zeros. Returns the encoded length.
+static inline size_t telemetry_cobs_encode(const uint8_t *in, size_t length, uint8_t *out) {
+    size_t code_at = 0;
+    size_t n = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        } else {
+            out[n++] = in[i];
+            if (++code == 0xFF) {
+                out[code_at] = code;
+                code_at = n++;
+                code = 1;
+            }
+        }
+    }
+    out[code_at] = code;
+    return n;
+}
+
+// Returns the decoded length, 0 for malformed input
+static inline size_t telemetry_cobs_decode(const uint8_t *in, size_t length, uint8_t *out) {
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < length) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > length) return 0;
+        for (uint8_t j = 1; j < code; j++) {
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < length) out[n++] = 0;
+    }
+    return n;
+}
+
+#endif // !TELEMETRY_H
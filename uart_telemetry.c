@@ -0,0 +1,64 @@
+#include "uart_telemetry.h"
+
+#include <pico/stdlib.h>
+#include <hardware/dma.h>
+
+void uart_telemetry_init(uart_telemetry_t *tm, uart_inst_t *uart) {
+    tm->uart = uart;
+    tm->dma_channel = dma_claim_unused_channel(true);
+    tm->head = 0;
+    tm->tail = 0;
+    tm->in_flight = 0;
+    tm->dropped = 0;
+}
+
+bool uart_telemetry_send(uart_telemetry_t *tm, const void *record, size_t length) {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    if (length > TELEMETRY_MAX_RECORD) return false;
+
+    size_t n = 0;
+    frame[n++] = 0;
+    n += telemetry_cobs_encode(record, length, &frame[n]);
+    frame[n++] = 0;
+
+    if (UART_TELEMETRY_RING_SIZE - (tm->head - tm->tail) < n) {
+        tm->dropped++;
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        tm->ring[(tm->head + i) & (UART_TELEMETRY_RING_SIZE - 1)] = frame[i];
+    }
+    tm->head += n;
+
+    uart_telemetry_poll(tm);
+    return true;
+}
+
+void uart_telemetry_poll(uart_telemetry_t *tm) {
+    if (tm->in_flight) {
+        if (dma_channel_is_busy(tm->dma_channel)) return;
+        tm->tail += tm->in_flight;
+        tm->in_flight = 0;
+    }
+    if (tm->head == tm->tail) return;
+
+    // one contiguous piece per transfer, the part after the wrap goes next time
+    uint32_t start = tm->tail & (UART_TELEMETRY_RING_SIZE - 1);
+    uint32_t length = tm->head - tm->tail;
+    if (length > UART_TELEMETRY_RING_SIZE - start) length = UART_TELEMETRY_RING_SIZE - start;
+
+    dma_channel_config config = dma_channel_get_default_config(tm->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, uart_get_dreq(tm->uart, true));
+    dma_channel_configure(tm->dma_channel, &config, &uart_get_hw(tm->uart)->dr, &tm->ring[start], length, true);
+    tm->in_flight = length;
+}
+
+void uart_telemetry_flush(uart_telemetry_t *tm) {
+    while (tm->in_flight || tm->head != tm->tail) {
+        uart_telemetry_poll(tm);
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef UART_TELEMETRY_H
+#define UART_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <hardware/uart.h>
+#include "telemetry.h"
+
+// Must be a power of 2, several frames fit at any time
+#define UART_TELEMETRY_RING_SIZE 1024
+
+// Telemetry frames are queued in a ring and a DMA channel feeds them to the
+// UART TX FIFO in the background. All calls come from the same core.
+typedef struct {
+    uart_inst_t *uart;
+    int dma_channel;
+    uint8_t ring[UART_TELEMETRY_RING_SIZE];
+    uint32_t head;          // bytes queued, free running
+    uint32_t tail;          // bytes sent, free running
+    uint32_t in_flight;     // bytes of the running transfer
+    uint32_t dropped;       // records that did not fit into the ring
+} uart_telemetry_t;
+
+void uart_telemetry_init(uart_telemetry_t *tm, uart_inst_t *uart);
+// Queues one record as a COBS frame, false when the ring is full
+bool uart_telemetry_send(uart_telemetry_t *tm, const void *record, size_t length);
+// Starts the next transfer once the previous one is done, call regularly
+void uart_telemetry_poll(uart_telemetry_t *tm);
+// Waits until everything queued has gone out, before printing text to the same UART
+void uart_telemetry_flush(uart_telemetry_t *tm);
+
+#endif // !UART_TELEMETRY_H
@@ -1,44 +1,106 @@
-#ifndef Units_h
-#define Units
-
-void printFreq(char *s, long frequency_hz){
-
-        // 0 HZ
-        if (frequency_hz < 1.0f) {
-        sprintf(s, "<1 Hz");
-        // 0.999 - 9.99 HZ
-        } else if (frequency_hz < 10.0f) {
-        sprintf(s, "%.3f Hz", frequency_hz / 1.0);
-        // 10.00 - 99.99 HZ
-        } else if (frequency_hz < 100.0f) {
-        sprintf(s, "%.2f Hz", frequency_hz / 1.0);
-        // 100.0 - 999.9 HZ
-        } else if (frequency_hz < 1000.0f) {
-        sprintf(s, "%.1f Hz", frequency_hz / 1.0);
-
-        // 1.000 - 9.999 KHz
-        } else if (frequency_hz < 10000.0f) {
-        sprintf(s, "%.3f KHz", frequency_hz / 1000.0);
-        // 10.00 - 99.99 KHz
-        } else if (frequency_hz < 100000.0f) {
-        sprintf(s, "%.2f KHz", frequency_hz / 1000.0);
-        // 100.1 - 999.9 KHz
-        } else if (frequency_hz < 1000000.0f) {
-        sprintf(s, "%.1f KHz", frequency_hz / 1000.0);
-
-        // 1.000 - 9.999 MHz
-        } else if (frequency_hz < 10000000.0f) {
-        sprintf(s, "%.3f MHz", frequency_hz / 1000000.0);
-        // 10.00 - 99.99 MHz
-        } else if (frequency_hz < 100000000.0f) {
-        sprintf(s, "%.2f MHz", frequency_hz / 1000000.0);
-        // 100.1 - 999.9 MHz
-        } else if (frequency_hz < 1000000000.0f) {
-        sprintf(s, "%.1f MHz", frequency_hz / 1000000.0);
-        // > 1 GHz 
-        } else {
-        sprintf(s, ">1 GHz");
-        }
+#ifndef UNITS_H
+#define UNITS_H
 
+#include <stdint.h>
+#include <string.h>
+
+// Integer measurement units: frequencies in milli-Hz, duty cycles in basis
+// points (1/100 %), pulse lengths in 24.8 fixed point. Nothing here touches
+// float, the RP2040 would have to emulate it.
+
+// num * scale / den, rounded down, without overflowing num * scale; scale * den must fit 64 bits
+static inline uint64_t scaled_div(uint64_t num, uint32_t scale, uint64_t den) {
+    return (num / den) * scale + (num % den) * scale / den;
+}
+
+// Writes value / 10^shift with `decimals` digits after the point, rounded; a
+// carry adds a digit in front, callers choosing digits by magnitude round first.
+// Returns the number of characters written (without the terminating zero).
+static inline int printFixed(char *s, uint64_t value, int shift, int decimals) {
+    uint64_t div = 1;
+    for (int i = decimals; i < shift; i++) div *= 10;
+    value = (value + div / 2) / div;
+
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value || n <= decimals);
+
+    int length = 0;
+    while (n > 0) {
+        if (n == decimals) s[length++] = '.';
+        s[length++] = digits[--n];
+    }
+    s[length] = 0;
+    return length;
+}
+
+// Basis points as a percentage with one decimal, like "50.0%"
+static inline int printPercent(char *s, uint32_t basis_points) {
+    int length = printFixed(s, basis_points, 2, 1);
+    strcpy(&s[length], "%");
+    return length + 1;
+}
+
+// 4 significant digits with Hz / KHz / MHz, like "12.34 KHz"
+static inline void printFreqMilliHz(char *s, uint64_t frequency_mhz) {
+    static const char *const units[] = {" Hz", " KHz", " MHz"};
+
+    if (frequency_mhz < 1000) {
+        strcpy(s, "<1 Hz");
+        return;
+    }
+    if (frequency_mhz >= 1000000000000ull) {
+        strcpy(s, ">1 GHz");
+        return;
+    }
+
+    // decade above 1 Hz: 0 for 1 - 9.999 Hz ... 8 for 100 - 999.9 MHz
+    int decade = 0;
+    uint64_t step = 1; // milli-Hz per last digit shown, 10^decade
+    for (uint64_t limit = 10000; frequency_mhz >= limit; limit *= 10) {
+        decade++;
+        step *= 10;
+    }
+    // rounding to 4 digits may carry into the next decade, 9.9996 KHz is 10.00 KHz
+    frequency_mhz = (frequency_mhz + step / 2) / step * step;
+    if (frequency_mhz >= step * 10000) decade++;
+    if (frequency_mhz >= 1000000000000ull) {
+        strcpy(s, ">1 GHz");
+        return;
+    }
+
+    int unit = decade / 3;
+    s += printFixed(s, frequency_mhz, 3 + 3 * unit, 3 - decade % 3);
+    strcpy(s, units[unit]);
 }
-#endif
\ No newline at end of file
+
+// 3 significant digits with ns / us / ms from hundredths of a nanosecond,
+// like "12.3ns"; returns the number of characters written
+static inline int printNanosX100(char *s, uint64_t ns_x100) {
+    static const char *const units[] = {"ns", "us", "ms"};
+
+    // decade above 1 ns: 0 for 0 - 9.99 ns ... 8 for 100 - 999 ms
+    int decade = 0;
+    uint64_t step = 1; // hundredths of a nanosecond per last digit shown, 10^decade
+    for (uint64_t limit = 1000; ns_x100 >= limit; limit *= 10) {
+        decade++;
+        step *= 10;
+    }
+    // rounding to 3 digits may carry into the next decade, like in printFreqMilliHz
+    ns_x100 = (ns_x100 + step / 2) / step * step;
+    if (ns_x100 >= step * 1000) decade++;
+    if (decade >= 9) {
+        strcpy(s, ">1s");
+        return 3;
+    }
+
+    int unit = decade / 3;
+    int length = printFixed(s, ns_x100, 2 + 3 * unit, 2 - decade % 3);
+    strcpy(&s[length], units[unit]);
+    return length + 2;
+}
+
+#endif // !UNITS_H
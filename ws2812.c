@@ -8,6 +8,8 @@
 
 // Initialize the WS2812 LED
 void ws2812_init(ws2812_t* ws2812) {
+    // claimed so that pio_claim_unused_sm on the same PIO passes it over
+    pio_sm_claim(ws2812->pio, ws2812->sm);
     ws2812->offset = pio_add_program(ws2812->pio, &ws2812_program);
     ws2812_program_init(ws2812->pio, ws2812->sm, ws2812->offset, ws2812->pin, 800000, ws2812->rgbw);
 }
@@ -1,6 +1,8 @@
 #include <hardware/uart.h>
 #include <pico/stdlib.h>
 #include <pico/stdio.h>
+#include <pico/stdio_usb.h>
+#include <pico/multicore.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -10,6 +12,14 @@
 #include "analyzer.h"
 #include "units.h"
 #include "button.h"
+#include "glitch.h"
+#include "freqmeter.h"
+#include "edgecounter.h"
+#include "sump.h"
+#include "uart_telemetry.h"
+#include "decoder.h"
+#include "eye.h"
+#include "ets.h"
 
 // Buttons
 #define BTN_RIGHT_PIN 14
@@ -19,6 +29,36 @@
 #define MIN_DISPLAY_SAMPLES 2
 #define MAX_DISPLAY_SAMPLES 32
 #define DISPLAY_SAMPLES 8
+// redraw period of core1 when no capture arrives
+#define DISPLAY_REFRESH_US 20000
+
+// Auto-ranging timebase: periods per whole buffer aimed for, longest capture duration
+#define AUTORANGE_TARGET_PERIODS 64
+#define AUTORANGE_MAX_CAPTURE_MS 4000
+
+// Screens, switched by pressing both buttons together
+enum {
+    SCREEN_WAVEFORM = 0,
+    SCREEN_ZOOM,
+    SCREEN_EYE,
+    SCREEN_ETS,
+    SCREEN_HISTOGRAM,
+    SCREEN_DECODE,
+    SCREEN_GLITCH,
+    SCREEN_COUNTER,
+    SCREEN_COUNT
+};
+
+// shared between core0 (sampler) and core1 (analysis, display, buttons)
+volatile uint32_t display_samples = DISPLAY_SAMPLES;
+volatile uint32_t display_screen = SCREEN_WAVEFORM;
+// zoom screen: log2 samples per column and the first sample shown; the
+// buttons pan by a quarter of the window within capture_samples
+volatile uint32_t display_zoom = 0;
+volatile uint32_t display_offset = 0;
+volatile uint32_t capture_samples = 0;
+volatile uint32_t blocks_released = 0;
+volatile uint32_t requested_sample_rate = 0; // set by core1, applied by core0 between blocks
 
 // Debug UART
 #define DBG_UART_ID uart0
@@ -29,6 +69,18 @@
 #define DBG_UART_STOP_BITS 1
 #define DBG_PARITY UART_PARITY_NONE
 
+// What goes to the debug UART: 0 binary telemetry records only (decode with
+// host/telemetry_decode), 1 adds a status line per block, 2 adds the text dump
+#define DEBUG_LEVEL 0
+
+// text shares the UART with the telemetry DMA, so queued frames go out first
+#define DEBUG_PRINTF(level, ...) do { \
+        if (DEBUG_LEVEL >= (level)) { \
+            uart_telemetry_flush(&telemetry); \
+            printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
 // OnBoard RGB Led
 ws2812_t ws2812 = {
     .pio = pio1,
@@ -45,23 +97,151 @@ ssd1306_t oled = {
     .height = 64,
     .address = 0x3C,
     .external_vcc = false,
+    .fast_mode_plus = false, // set for panels that accept 1 MHz I2C
     .SDA = 4,
     .SCL = 5,
 };
 
 
+// Uncomment to compare the word-parallel analyzer with the bit-serial reference at boot
+// #define ANALYZER_BENCHMARK
+
+// Timebase profile (sampler.h): SAMPLER_PROFILE_STANDARD samples at 32 MS/s,
+// _FAST at 200 MS/s and _TURBO at 250 MS/s with the system clock and core
+// voltage raised to match
+#define TIMEBASE_PROFILE SAMPLER_PROFILE_STANDARD
+// the sample rate measured at boot may be this many parts per thousand off
+#define TIMEBASE_TOLERANCE_PERMILLE 5
+
 // Signal sampler
 #define SIGNAL_PIN 8
+// channels on consecutive pins from SIGNAL_PIN: 1, 2, 4 or 8 (8 would take the button pins)
+#define SIGNAL_CHANNELS 1
+
+// Uncomment to capture around a trigger on channel 0 instead of streaming gapless blocks.
+// Without a trigger for TRIGGER_TIMEOUT_MS the newest samples are shown untriggered.
+// #define SIGNAL_TRIGGER SAMPLER_TRIGGER_RISING
+#define TRIGGER_PRE_PERCENT 25
+#define TRIGGER_TIMEOUT_MS 500
+
+// Uncomment to record the run lengths of channel 0 instead of raw samples: the
+// buffer then holds BUFFER_SIZE runs, taken for at most RLE_WINDOW_MS
+// #define SIGNAL_RLE
+#define RLE_WINDOW_MS 2000
 #define BUFFER_SIZE 32768
 
 uint32_t sampler_buffer[BUFFER_SIZE];
+
+// Run-length form of the last capture, one per channel (channel 0 drives the display)
+#define EDGE_LIST_SIZE 2048
+// runs shorter than this many samples are counted as glitches
+#define GLITCH_THRESHOLD 3
+
+edge_run_t edge_runs[SIGNAL_CHANNELS][EDGE_LIST_SIZE];
+edge_list_t edge_lists[SIGNAL_CHANNELS];
+
+// Channel 0 of the last capture drawn, kept while the next one is appended so
+// the display can follow the settings in between; its runs swap places with
+// those of edge_lists[0] when a capture is drawn
+edge_run_t shown_runs[EDGE_LIST_SIZE];
+edge_list_t shown_list;
+
+// Min/max pyramid of channel 0 for the zoom screen, sized for a whole-buffer capture
+#define PYRAMID_SIZE PYRAMID_STORAGE_WORDS(BUFFER_SIZE / SIGNAL_CHANNELS)
+
+uint32_t pyramid_storage[PYRAMID_SIZE];
+pyramid_t pyramid;
+// stands in while the pyramid holds a capture other than the one shown, the runs are drawn instead
+const pyramid_t no_pyramid;
+
+// Persistence view of channel 0, the newest capture weighs 1 / 2^EYE_DECAY_SHIFT; used by core1 only
+#define EYE_DECAY_SHIFT 2
+
+eye_t eye;
+
+// Equivalent-time view of channel 0 and the sample rate of its capture; used by core1 only
+ets_t ets;
+uint32_t ets_rate;
+
+// Uncomment to decode serial traffic. DECODE_UART reads channel 0; DECODE_SPI
+// and DECODE_I2C take the clock / SCL from channel 0 and data / SDA from
+// channel 1, SPI the chip select from channel 2 with 4 channels.
+// #define SIGNAL_DECODE DECODE_UART
+#define SPI_CPOL false
+#define SPI_CPHA false
+
+#ifdef SIGNAL_DECODE
+_Static_assert(SIGNAL_DECODE == DECODE_UART || SIGNAL_CHANNELS >= 2, "SPI and I2C decoding need 2 channels");
+
+decoder_t decoder = {
+    .protocol = SIGNAL_DECODE,
+    .clock = &edge_lists[0],
+    .data = &edge_lists[SIGNAL_CHANNELS > 1 ? 1 : 0],
+    .select = SIGNAL_CHANNELS > 2 && SIGNAL_DECODE == DECODE_SPI ? &edge_lists[2] : NULL,
+    .cpol = SPI_CPOL,
+    .cpha = SPI_CPHA,
+    .min_pulse = GLITCH_THRESHOLD
+};
+#endif
+// frames of the latest captures and the UART bit rate found, used by core1 only
+decode_ring_t decode_ring;
+uint32_t decode_baud;
+uint32_t sample_rate;
 sampler_t sampler = {
     .pio = pio0,
     .pin = SIGNAL_PIN,
+    .channel_count = SIGNAL_CHANNELS,
     .sample_buffer = sampler_buffer,
     .buffer_size = BUFFER_SIZE
 };
 
+// Reciprocal frequency counter on the same pin
+#define FREQMETER_GATE_MS 100
+#define FREQMETER_MAX_GATE_MS 10000
+// gate steps of the counter screen, a factor of 10 apart
+#define FREQMETER_SHORTEST_GATE_MS 10
+#define FREQMETER_LONGEST_GATE_MS 1000
+
+freqmeter_t freqmeter = {
+    .pio = pio0,
+    .pin = SIGNAL_PIN,
+    .gate_ms = FREQMETER_GATE_MS,
+    .max_gate_ms = FREQMETER_MAX_GATE_MS
+};
+
+// Gated edge counter on a PWM slice for signals above the reciprocal counter.
+// The slice counts on its B input, an odd GPIO: wire it to SIGNAL_PIN. With 2
+// or more channels GPIO 9 is channel 1 and the odd pins above the sampled ones
+// are taken, so the counter is left out and the reciprocal counter stands alone.
+#define EDGE_COUNTER_PIN 9
+#define EDGE_COUNTER_GATE_MS 1000
+#define EDGE_COUNTER_ENABLED (SIGNAL_CHANNELS == 1)
+
+_Static_assert(EDGE_COUNTER_PIN % 2 == 1, "PWM slices count on the B input, an odd GPIO");
+
+edge_counter_t edge_counter = {
+    .pin = EDGE_COUNTER_PIN,
+    .gate_ms = EDGE_COUNTER_GATE_MS
+};
+
+// Glitch catcher on channel 0, on the PIO next to the LED: runs shorter than
+// the threshold are counted and latched until cleared from the glitch screen.
+// The run right after a glitch is timed 4-5 cycles late (see glitch.pio).
+#define GLITCH_CATCHER_THRESHOLD_NS 50
+// the LED shows a glitch alarm this long before the capture status takes it back
+#define GLITCH_LED_MS 200
+
+glitch_catcher_t glitch_catcher = {
+    .pio = pio1,
+    .pin = SIGNAL_PIN
+};
+
+// SUMP / OpenBench Logic Sniffer session on the USB CDC port
+sump_t sump;
+
+// Measurement records on the debug UART, used by core1 only
+uart_telemetry_t telemetry;
+
 void setup_uart(uart_inst_t *uart, uint baudrate, uint tx, uint rx, uint databits, uint stopbits, uart_parity_t parity) {
     uart_init(uart, baudrate);
     
@@ -73,46 +253,52 @@ void setup_uart(uart_inst_t *uart, uint baudrate, uint tx, uint rx, uint databit
     uart_set_fifo_enabled(uart, true);
 }
 
-void print_analysis_result(const analysis_result_t * res, uint32_t capture_id, const uint32_t *buffer, double sample_rate, uint32_t display_samples) {
+void print_analysis_result(const analysis_result_t * res, uint32_t capture_id, const edge_list_t *edges, uint32_t first_run) {
     printf("\n=== Capture #%lu ===\n", capture_id);
     printf("Total samples: %lu\n", (unsigned long)res->total_samples);
     printf("High samples: %lu (%.1f%%)\n", (unsigned long)res->high_count,
            (res->high_count * 100.0) / res->total_samples);
 
-    printf("Avg low length: %.1f, Avg high length: %.1f\n", res->avg_low_pulse, res->avg_high_pulse);
+    printf("Avg low length: %.1f, Avg high length: %.1f\n", res->avg_low_pulse_q8 / 256.0, res->avg_high_pulse_q8 / 256.0);
 
     printf("Low samples: %lu (%.1f%%)\n", (unsigned long)(res->total_samples - res->high_count),
            ((res->total_samples - res->high_count) * 100.0) / res->total_samples);
     printf("Transitions: %lu\n", (unsigned long)res->transitions);
 
-    ssd1306_fill(&oled, 0);
     if (res->transitions > 1) {
-        printf("Estimated frequency: %.0f Hz\n", res->estimated_freq);
-
-        char s[16] = {0};
-        char d[16] = {0};
-        // sprintf(s, "%.3f KHz", res->estimated_freq / 1000.0);
-        printFreq (s, res->estimated_freq);
-
-        sprintf(d, "Duty %.1f%%", res->duty_cycle);
-        ssd1306_draw_string(&oled, 1, 1, s);
-        ssd1306_draw_string(&oled, 1, 24, d);
-
-        printf("(used computed capture duration %.3f ms from sample_rate %.2f Hz)\n", res->capture_duration_s * 1000.0, (double)(res->total_samples) / res->capture_duration_s);
+        printf("Estimated frequency: %llu.%03llu Hz\n", res->estimated_freq_mhz / 1000, res->estimated_freq_mhz % 1000);
+        printf("(used computed capture duration %lu us for %lu samples)\n", res->capture_duration_us, res->total_samples);
     }
 
     if (res->pulse_widths[0] > 0 && res->pulse_widths[1] > 0 && res->transitions > 1) {
-        printf("Average high pulse: %.2f samples\n", res->pulse_widths);
-        printf("Average low pulse: %.2f samples\n", res->avg_low_pulse);
+        printf("Average high pulse: %.2f samples\n", res->avg_high_pulse_q8 / 256.0);
+        printf("Average low pulse: %.2f samples\n", res->avg_low_pulse_q8 / 256.0);
     }
 
-    printf("Duty cycle: %.1f%%\n", res->duty_cycle);
+    printf("Duty cycle: %lu.%02lu%%\n", res->duty_bp / 100, res->duty_bp % 100);
 
-    // Reduced 32-bit pattern (remove spikes) and display
-    reduce_t reduced[128] = {0};
+    const pulse_stats_t *stats = &edges->stats;
+    if (stats->period.count > 0) {
+        printf("Period: min %lu, max %lu, mean %.2f, stddev %.2f samples (%lu periods)\n",
+               stats->period.min, stats->period.max, run_stats_mean_q8(&stats->period) / 256.0, run_stats_stddev_q8(&stats->period) / 256.0, stats->period.count);
+    }
+    for (int level = 1; level >= 0; level--) {
+        const run_stats_t *width = &stats->width[level];
+        if (width->count == 0) continue;
+        printf("%s pulse: min %lu, max %lu, stddev %.2f samples\n", level ? "High" : "Low",
+               width->min, width->max, run_stats_stddev_q8(width) / 256.0);
+    }
+    printf("Glitches (< %lu samples): %lu\n", stats->glitch_threshold, stats->glitches);
+    printf("Width histogram:");
+    for (int b = 0; b < PULSE_HISTOGRAM_BINS; b++) {
+        if (stats->histogram[b]) printf(" %u+:%lu", 1u << b, stats->histogram[b]);
+    }
+    printf("\n");
 
+    // Reduced 32-bit pattern (remove spikes)
+    reduce_t reduced[128] = {0};
 
-    reduce_buffer_to_32(buffer, res->word_count, reduced, res->high_count / (res->transitions * 2));
+    reduce_edges_to_32(edges, first_run, reduced, res->high_count / (res->transitions * 2));
 
     printf("reduced:\n");
     for (int i = 0; i < 32; ++i) {
@@ -124,7 +310,138 @@ void print_analysis_result(const analysis_result_t * res, uint32_t capture_id, c
     }
     printf("\n");
 
+    printf("First 10 words (LSB first):\n");
+    for (int i = 0; i < 10 && i < (int)res->word_count; i++) {
+        printf("\n  Word %d: 0x%08lx - ", i, (unsigned long)res->first_words[i]);
+        for (int bit = 0; bit < 32; bit++) {
+            printf("%d", (res->first_words[i] >> bit) & 1);
+        }
+    }
+    printf("\n");
+
+    if (res->signal_type == SIGNAL_TYPE_CONSTANT) {
+        printf("Signal: Constant %s\n", (res->high_count == res->total_samples) ? "HIGH" : "LOW");
+    } else if (res->signal_type == SIGNAL_TYPE_PERFECT_SQUARE) {
+        printf("Signal: Perfect square wave\n");
+    } else if (res->signal_type == SIGNAL_TYPE_PERIODIC) {
+        printf("Signal: Periodic waveform\n");
+    }
+
+    printf("====================\n");
+}
+
+// Queues the measurement record of a block: the capture record for channel 0
+// (res is NULL without activity) and one record per further channel
+void send_telemetry(const sampler_block_t *block, uint32_t capture_id, const analysis_result_t *res,
+                    const edge_list_t *edges, uint32_t first_run, uint64_t freq_mhz, uint64_t counter_freq_mhz) {
+    const edge_list_t *list = &edges[0];
+    telemetry_capture_t rec = {
+        .type = TELEMETRY_RECORD_CAPTURE,
+        .channel_count = block->rle ? 1 : SIGNAL_CHANNELS,
+        .capture_id = capture_id,
+        .block_seq = block->seq,
+        .overruns = sampler.overruns,
+        .sample_rate = (uint32_t)block->sample_rate,
+        .total_samples = list->total_samples,
+        .high_count = list->high_count,
+        .transitions = list->rising + list->falling,
+        .duty_bp = calculate_duty_cycle(list),
+        .trigger_sample = block->trigger_sample == SAMPLER_NO_TRIGGER ? TELEMETRY_NO_TRIGGER : block->trigger_sample,
+        .counter_freq_mhz = counter_freq_mhz
+    };
+    if (block->rle) rec.flags |= TELEMETRY_FLAG_RLE;
+    if (block->trigger_sample != SAMPLER_NO_TRIGGER) rec.flags |= TELEMETRY_FLAG_TRIGGERED;
 
+    if (res) {
+        rec.flags |= TELEMETRY_FLAG_ACTIVE;
+        if (counter_freq_mhz > 0 && freq_mhz == counter_freq_mhz) rec.flags |= TELEMETRY_FLAG_COUNTER;
+        rec.signal_type = res->signal_type;
+        rec.avg_high_pulse_q8 = res->avg_high_pulse_q8;
+        rec.avg_low_pulse_q8 = res->avg_low_pulse_q8;
+        rec.freq_mhz = freq_mhz;
+
+        reduce_t reduced[128] = {0};
+        reduce_edges_to_32(list, first_run, reduced, res->high_count / (res->transitions * 2));
+        for (int i = 0; i < 32; i++) {
+            if (reduced[i] != reduced_zero) rec.reduced |= 1u << i;
+            if (reduced[i] == reduced_pin) rec.reduced_spikes |= 1u << i;
+        }
+    }
+    uart_telemetry_send(&telemetry, &rec, sizeof(rec));
+    if (!res) return;
+
+    const pulse_stats_t *stats = &list->stats;
+    telemetry_pulses_t pulses = {
+        .type = TELEMETRY_RECORD_PULSES,
+        .capture_id = capture_id,
+        .glitches = stats->glitches,
+        .periods = stats->period.count,
+        .period_min = stats->period.count ? stats->period.min : 0,
+        .period_max = stats->period.max,
+        .period_mean_q8 = run_stats_mean_q8(&stats->period),
+        .period_stddev_q8 = run_stats_stddev_q8(&stats->period),
+        .high_min = stats->width[1].count ? stats->width[1].min : 0,
+        .high_max = stats->width[1].max,
+        .low_min = stats->width[0].count ? stats->width[0].min : 0,
+        .low_max = stats->width[0].max
+    };
+    for (int b = 0; b < TELEMETRY_HISTOGRAM_BINS; b++) {
+        pulses.histogram[b] = stats->histogram[b] > 0xFFFF ? 0xFFFF : stats->histogram[b];
+    }
+    uart_telemetry_send(&telemetry, &pulses, sizeof(pulses));
+
+    if (block->rle) return;
+    for (uint c = 1; c < SIGNAL_CHANNELS; c++) {
+        analysis_result_t channel = analyze_edge_list(&edges[c], rec.sample_rate);
+        telemetry_channel_t ch = {
+            .type = TELEMETRY_RECORD_CHANNEL,
+            .channel = c,
+            .capture_id = capture_id,
+            .transitions = channel.transitions,
+            .duty_bp = channel.duty_bp,
+            .freq_mhz = channel.estimated_freq_mhz
+        };
+        uart_telemetry_send(&telemetry, &ch, sizeof(ch));
+    }
+}
+
+// Queues the frames decoded from a block, oldest first, TELEMETRY_FRAMES per record
+void send_decoded_frames(uint32_t capture_id, uint8_t protocol, uint32_t count, bool truncated) {
+    telemetry_frames_t rec = {
+        .type = TELEMETRY_RECORD_FRAMES,
+        .protocol = protocol,
+        .flags = truncated ? TELEMETRY_FRAMES_TRUNCATED : 0,
+        .capture_id = capture_id,
+        .baud = decode_baud
+    };
+    if (count > DECODE_RING_SIZE) count = DECODE_RING_SIZE;
+    while (count > 0) {
+        rec.count = 0;
+        while (count > 0 && rec.count < TELEMETRY_FRAMES) {
+            const decoded_frame_t *frame = decode_ring_get(&decode_ring, --count);
+            rec.frames[rec.count++] = frame->value | frame->flags << 8;
+        }
+        uart_telemetry_send(&telemetry, &rec, sizeof(rec));
+    }
+}
+
+void draw_analysis_result(const analysis_result_t * res, const edge_list_t *edges, uint32_t first_run, uint64_t freq_mhz, uint32_t display_samples) {
+    ssd1306_fill(&oled, 0);
+    if (res->transitions > 1) {
+        char s[16] = {0};
+        char d[16] = {0};
+        printFreqMilliHz(s, freq_mhz);
+
+        strcpy(d, "Duty ");
+        printPercent(&d[5], res->duty_bp);
+        ssd1306_draw_string(&oled, 1, 1, s);
+        ssd1306_draw_string(&oled, 1, 24, d);
+    }
+
+    // Reduced 32-bit pattern (remove spikes) and display
+    reduce_t reduced[128] = {0};
+
+    reduce_edges_to_32(edges, first_run, reduced, res->high_count / (res->transitions * 2));
 
     // char bits[33] = {0};
     // uint32_t display_samples = 16;
@@ -136,36 +453,30 @@ void print_analysis_result(const analysis_result_t * res, uint32_t capture_id, c
     reduce_t last_val = reduced[0];
     uint16_t cursor = 0;
 
-    uint16_t zero_width = (1.0 - (res->duty_cycle / 100.0)) * sample_width * 4.0;
-    uint16_t one_width = (res->duty_cycle / 100.0) * sample_width * 4.0;
-    // uint16_t zero_width = (1.0 - (res->duty_cycle / 100.0)) * sample_width;
-    // uint16_t one_width = (res->duty_cycle / 100.0) * sample_width;
+    uint16_t zero_width = (10000 - res->duty_bp) * sample_width * 4 / 10000;
+    uint16_t one_width = res->duty_bp * sample_width * 4 / 10000;
 
     for (uint32_t i = 0; i < display_samples; i++) {
 
         if (last_val != reduced[i]) {
-            for (int n = one_y; n < zero_y; ++n)
-                ssd_draw_fullpixel(&oled, cursor, n, true, 1);
+            ssd1306_draw_vspan(&oled, cursor, one_y, sample_height);
         }
         
         switch (reduced[i]) {
             case reduced_one: {
-                for (int n = 0; n < one_width; ++n)
-                    ssd_draw_fullpixel(&oled, cursor + n, one_y, true, 1);
+                ssd1306_draw_hspan(&oled, cursor, one_y, one_width);
                 cursor += one_width;    
                 last_val = reduced[i];
             } break;
             
             case reduced_zero: {
-                for (int n = 0; n < zero_width; ++n)
-                    ssd_draw_fullpixel(&oled, cursor + n, zero_y, true, 1);
+                ssd1306_draw_hspan(&oled, cursor, zero_y, zero_width);
                 cursor += zero_width;    
                 last_val = reduced[i];
             } break;
 
             case reduced_pin: {
-                for (int n = one_y; n < zero_y; ++n)
-                    ssd_draw_fullpixel(&oled, cursor, n, true, 1);
+                ssd1306_draw_vspan(&oled, cursor, one_y, sample_height);
                 cursor += 1;    
             } break;
         }
@@ -173,124 +484,888 @@ void print_analysis_result(const analysis_result_t * res, uint32_t capture_id, c
             break;
     }
 
-    putchar('\n');
     // ssd1306_draw_string(&oled, 1, 40, bits);
-    ssd1306_show(&oled);
+    ssd1306_show_async(&oled);
+}
 
-    printf("First 10 words (LSB first):\n");
-    for (int i = 0; i < 10 && i < (int)res->word_count; i++) {
-        printf("\n  Word %d: 0x%08lx - ", i, (unsigned long)res->first_words[i]);
-        for (int bit = 0; bit < 32; bit++) {
-            printf("%d", (res->first_words[i] >> bit) & 1);
+// Zoom screen: samples per column, the visible part of the capture as a bar
+// and below it one column per 2^zoom samples, drawn from the pyramid
+void draw_zoomed(const pyramid_t *pyr, const edge_list_t *edges, uint32_t zoom, uint32_t offset) {
+    ssd1306_fill(&oled, 0);
+
+    char s[16] = {0};
+    sprintf(s, "1:%lu", 1ul << zoom);
+    ssd1306_draw_string(&oled, 1, 0, s);
+
+    uint32_t total = edges->total_samples;
+    if (total > 0) {
+        uint32_t window = oled.width << zoom;
+        uint16_t x = (uint64_t)offset * oled.width / total;
+        uint16_t w = (uint64_t)(window < total ? window : total) * oled.width / total;
+        ssd1306_draw_hspan(&oled, 0, 19, oled.width);
+        ssd1306_draw_hspan(&oled, x, 17, w > 0 ? w : 1);
+        ssd1306_draw_hspan(&oled, x, 18, w > 0 ? w : 1);
+    }
+
+    uint8_t columns[128];
+    render_columns(pyr, edges, offset, zoom, columns, oled.width);
+
+    const uint8_t one_y = 26;
+    const uint8_t zero_y = 62;
+    for (uint8_t x = 0; x < oled.width; x++) {
+        uint8_t flags = columns[x];
+        // an edge or both levels within a column fill it from level to level
+        if ((flags & PYRAMID_EDGE) || (flags & (PYRAMID_HIGH | PYRAMID_LOW)) == (PYRAMID_HIGH | PYRAMID_LOW)) {
+            ssd1306_draw_vspan(&oled, x, one_y, zero_y - one_y + 1);
+        } else if (flags & PYRAMID_HIGH) {
+            ssd1306_draw_pixel(&oled, x, one_y, true);
+        } else if (flags & PYRAMID_LOW) {
+            ssd1306_draw_pixel(&oled, x, zero_y, true);
         }
     }
-    printf("\n");
 
-    if (res->signal_type == SIGNAL_TYPE_CONSTANT) {
-        printf("Signal: Constant %s\n", (res->high_count == res->total_samples) ? "HIGH" : "LOW");
-    } else if (res->signal_type == SIGNAL_TYPE_PERFECT_SQUARE) {
-        printf("Signal: Perfect square wave\n");
-    } else if (res->signal_type == SIGNAL_TYPE_PERIODIC) {
-        printf("Signal: Periodic waveform\n");
+    ssd1306_show_async(&oled);
+}
+
+// Ordered dither thresholds, a share above the threshold of a pixel lights it
+static const uint8_t bayer4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5}
+};
+
+static inline bool dither(uint16_t share, uint8_t x, uint8_t y) {
+    return share > bayer4[y & 3][x & 3] * 4096u + 2048u;
+}
+
+// Eye screen: the folded periods of the recent captures. The high and low
+// bands and the edges between them get darker the fewer periods pass there;
+// the tick marks the rising edge everything is folded on.
+void draw_eye(const eye_t *view) {
+    ssd1306_fill(&oled, 0);
+
+    char s[16] = {0};
+    sprintf(s, "Eye %lu", view->periods);
+    ssd1306_draw_string(&oled, 1, 0, s);
+    if (view->span == 0) {
+        ssd1306_show_async(&oled);
+        return;
     }
 
-    printf("====================\n");
+    const uint8_t one_y = 22;
+    const uint8_t zero_y = 58;
+    const uint8_t band = 4;
+    ssd1306_draw_vspan(&oled, (uint64_t)view->pre * EYE_COLUMNS / view->span, 17, 4);
+    for (uint8_t x = 0; x < EYE_COLUMNS; x++) {
+        uint16_t high = view->high[x];
+        for (uint8_t y = one_y; y < one_y + band; y++) {
+            if (dither(high, x, y)) ssd1306_draw_pixel(&oled, x, y, true);
+        }
+        for (uint8_t y = zero_y; y < zero_y + band; y++) {
+            if (dither(65535 - high, x, y)) ssd1306_draw_pixel(&oled, x, y, true);
+        }
+        for (uint8_t y = one_y + band; y < zero_y; y++) {
+            if (dither(view->edge[x], x, y)) ssd1306_draw_pixel(&oled, x, y, true);
+        }
+    }
+
+    ssd1306_show_async(&oled);
 }
 
-int main() {
-    stdio_init_all();
-    set_sys_clock_hz(128000000, true);
+// 16.16 samples at `rate` in hundredths of a nanosecond: 10^11 / 2^16 = 48828125 / 32
+static inline uint64_t ets_ns_x100(uint64_t samples_q16, uint32_t rate) {
+    return scaled_div(samples_q16, 48828125, (uint64_t)rate * 32);
+}
 
-    Button btn1;
-    button_init(&btn1, BTN_LEFT_PIN);  // кнопка на GPIO2
-    Button btn2;
-    button_init(&btn2, BTN_RIGHT_PIN);  // кнопка на GPIO2
-    
-    ws2812_init(&ws2812);
-    set_rgb(127, 0, 0, &ws2812);
+// Hundredths of a nanosecond in at most 8 characters for the 10 character ETS
+// lines: as many decimals as fit, microseconds and up past 99999 ns
+static int print_ets_ns(char *s, uint64_t ns_x100) {
+    int n;
+    if (ns_x100 < 100000) {
+        n = printFixed(s, ns_x100, 2, 2);
+    } else if (ns_x100 + 5 < 1000000) {
+        n = printFixed(s, ns_x100, 2, 1);
+    } else if (ns_x100 + 50 < 10000000) {
+        n = printFixed(s, ns_x100, 2, 0);
+    } else {
+        return printNanosX100(s, ns_x100);
+    }
+    strcpy(&s[n], "ns");
+    return n + 2;
+}
 
-    setup_uart(DBG_UART_ID, DBG_UART_BAUDRATE, DBG_UART_TX_PIN, DBG_UART_RX_PIN, DBG_UART_DATA_BITS, DBG_UART_STOP_BITS, DBG_PARITY);
-    stdio_uart_init();
+// Equivalent-time screen: period, duty and the first rising edge of the capture
+// from the folded edges, a line each, below them one period with the rising edge
+// at the tick. The slopes are as wide as the sample the edges fall in, their
+// middle is the edge. The glyph rows below 14 are blank, so the lines are 14 apart.
+void draw_ets(const ets_t *view, uint32_t rate) {
+    ssd1306_fill(&oled, 0);
 
-    printf("Starting...");
-    printf("System clock set to %lu MHz\n", (unsigned long)(clock_get_hz(clk_sys) / 1000000.));
+    char s[24] = {0};
+    if (view->periods == 0 || rate == 0) {
+        ssd1306_draw_string(&oled, 1, 1, "ETS:");
+        ssd1306_draw_string(&oled, 1, 17, "no period");
+        ssd1306_show_async(&oled);
+        return;
+    }
+    strcpy(s, "T ");
+    print_ets_ns(&s[2], ets_ns_x100(view->period_q16, rate));
+    ssd1306_draw_string(&oled, 1, 0, s);
+    strcpy(s, "D ");
+    int n = 2 + printFixed(&s[2], view->duty_bp, 2, 2);
+    strcpy(&s[n], "%");
+    ssd1306_draw_string(&oled, 1, 14, s);
+    strcpy(s, "R ");
+    print_ets_ns(&s[2], ets_ns_x100(view->rise_q16, rate));
+    ssd1306_draw_string(&oled, 1, 28, s);
 
-    ssd1306_init(&oled);
-    ssd1306_fill(&oled, 255);
-    ssd1306_show(&oled);
+    const uint8_t one_y = 47;
+    const uint8_t zero_y = 62;
+    ssd1306_draw_vspan(&oled, ETS_COLUMNS / 8, 44, 3);
+    uint8_t last_y = zero_y;
+    for (uint8_t x = 0; x < ETS_COLUMNS; x++) {
+        uint8_t y = zero_y - (uint8_t)((uint32_t)view->high[x] * (zero_y - one_y) / 65535);
+        // join the steps so the slopes stay connected
+        if (x > 0 && y != last_y) {
+            uint8_t top = y < last_y ? y : last_y;
+            ssd1306_draw_vspan(&oled, x, top, (y < last_y ? last_y - y : y - last_y) + 1);
+        } else {
+            ssd1306_draw_pixel(&oled, x, y, true);
+        }
+        last_y = y;
+    }
 
-    const double sample_rate = setup_sampler(&sampler);
-    
-    printf("Configuration:\n");
-    printf("  Sample pin: GPIO%d\n", SIGNAL_PIN);
-    printf("  Sample rate: %.1f\n", sample_rate);
-    printf("  Buffer size: %d words (%d samples)\n", BUFFER_SIZE, BUFFER_SIZE * 32);
-    printf("  Starting continuous capture...\n\n");
-    sleep_ms(200);
-    
+    ssd1306_show_async(&oled);
+}
+
+// Histogram screen: period jitter (its standard deviation, as a time at the
+// capture's sample rate) and glitch count, below them the pulse widths of
+// both levels in log2 bins, one 8 pixel column per bin
+void draw_pulse_histogram(const pulse_stats_t *stats, uint32_t rate) {
+    ssd1306_fill(&oled, 0);
+
+    char s[16] = {0};
+    strcpy(s, "Jit ");
+    if (rate > 0) {
+        // 24.8 samples in hundredths of a nanosecond: 10^11 / 2^8 = 390625000
+        printNanosX100(&s[4], scaled_div(run_stats_stddev_q8(&stats->period), 390625000, rate));
+    }
+    ssd1306_draw_string(&oled, 1, 1, s);
+    sprintf(s, "Glt %lu", stats->glitches);
+    ssd1306_draw_string(&oled, 1, 17, s);
+
+    uint32_t max = 0;
+    for (int b = 0; b < PULSE_HISTOGRAM_BINS; b++) {
+        if (stats->histogram[b] > max) max = stats->histogram[b];
+    }
+
+    const uint8_t bottom = 63;
+    const uint8_t bar_height = 30;
+    const uint8_t bar_width = oled.width / PULSE_HISTOGRAM_BINS;
+    for (int b = 0; max && b < PULSE_HISTOGRAM_BINS; b++) {
+        // any non-empty bin gets at least one row
+        uint32_t h = ((uint64_t)stats->histogram[b] * bar_height + max - 1) / max;
+        if (h == 0) continue;
+        for (uint8_t x = 0; x < bar_width - 1; x++) {
+            ssd1306_draw_vspan(&oled, b * bar_width + x, bottom + 1 - h, h);
+        }
+    }
+    ssd1306_draw_hspan(&oled, 0, bottom, oled.width);
+
+    ssd1306_show_async(&oled);
+}
+
+// Decode screen: protocol and bit rate, then the newest frames as hex, three per
+// line and the latest last. 'a' marks an I2C address, '!' an error or NACK; a
+// '>' at the top right says the edge lists filled up and later frames are lost.
+void draw_decoded(const decode_ring_t *ring) {
+    ssd1306_fill(&oled, 0);
+
+#ifdef SIGNAL_DECODE
+    static const char *const names[] = {"", "UART", "SPI", "I2C"};
+    char s[16] = {0};
+    strcpy(s, names[SIGNAL_DECODE]);
+    if (SIGNAL_DECODE == DECODE_UART && decode_baud) sprintf(&s[4], " %lu", decode_baud);
+    ssd1306_draw_string(&oled, 1, 0, s);
+    if (decoder.truncated) ssd1306_draw_string(&oled, oled.width - 12, 0, ">");
+
+    // STOP conditions carry no data and are not shown
+    uint32_t shown[9];
+    uint32_t count = 0;
+    for (uint32_t age = 0; count < 9 && age < ring->head && age < DECODE_RING_SIZE; age++) {
+        if (!(decode_ring_get(ring, age)->flags & DECODE_FLAG_STOP)) shown[count++] = age;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const decoded_frame_t *frame = decode_ring_get(ring, shown[count - 1 - i]);
+        char marker = frame->flags & (DECODE_FLAG_ERROR | DECODE_FLAG_NACK) ? '!' : frame->flags & DECODE_FLAG_START ? 'a' : ' ';
+        sprintf(s, "%02X%c", frame->value, marker);
+        ssd1306_draw_string(&oled, 1 + (i % 3) * 42, 16 + (i / 3) * 16, s);
+    }
+#else
+    (void)ring;
+    ssd1306_draw_string(&oled, 1, 1, "No decoder");
+#endif
+
+    ssd1306_show_async(&oled);
+}
+
+// Glitch screen, a line each as the font fits 10 characters across: glitches
+// latched since the last clear, the threshold in cycles and in time, and the
+// level and width of the latest glitch
+void draw_glitches(glitch_catcher_t *gc) {
+    ssd1306_fill(&oled, 0);
+
+    char s[16] = {0};
+    uint32_t sys_mhz = clock_get_hz(clk_sys) / 1000000;
+    uint32_t count = glitch_catcher_count(gc);
+    if (count < 1000000) {
+        sprintf(s, "Glt %lu", count);
+    } else {
+        sprintf(s, "Glt %luk", count / 1000);
+    }
+    ssd1306_draw_string(&oled, 1, 1, s);
+    sprintf(s, "<%lu cyc", gc->threshold_cycles);
+    ssd1306_draw_string(&oled, 1, 17, s);
+    strcpy(s, "<");
+    printNanosX100(&s[1], (uint64_t)gc->threshold_cycles * 100000 / sys_mhz);
+    ssd1306_draw_string(&oled, 1, 33, s);
+    if (count) {
+        uint8_t level;
+        uint32_t width = glitch_catcher_last(gc, &level);
+        strcpy(s, level ? "H " : "L ");
+        printNanosX100(&s[2], (uint64_t)width * 100000 / sys_mhz);
+        ssd1306_draw_string(&oled, 1, 49, s);
+    }
+
+    ssd1306_show_async(&oled);
+}
+
+// Counter screen: the frequency of the waveform screen and the gate time of
+// the reciprocal counter, which the buttons step
+void draw_counter(uint64_t freq_mhz, uint32_t gate_ms) {
+    ssd1306_fill(&oled, 0);
+
+    char s[16] = {0};
+    printFreqMilliHz(s, freq_mhz);
+    ssd1306_draw_string(&oled, 1, 1, s);
+    if (gate_ms >= 1000) {
+        sprintf(s, "Gate %lus", gate_ms / 1000);
+    } else {
+        sprintf(s, "Gate %lums", gate_ms);
+    }
+    ssd1306_draw_string(&oled, 1, 24, s);
+
+    ssd1306_show_async(&oled);
+}
+
+void draw_screen(uint32_t screen, const analysis_result_t * res, uint32_t rate, const pyramid_t *pyr, const edge_list_t *edges,
+                 uint32_t first_run, uint64_t freq_mhz, uint32_t display_samples, uint32_t zoom, uint32_t offset) {
+    if (screen == SCREEN_ZOOM) {
+        draw_zoomed(pyr, edges, zoom, offset);
+    } else if (screen == SCREEN_EYE) {
+        draw_eye(&eye);
+    } else if (screen == SCREEN_ETS) {
+        draw_ets(&ets, ets_rate);
+    } else if (screen == SCREEN_HISTOGRAM) {
+        draw_pulse_histogram(&edges->stats, rate);
+    } else if (screen == SCREEN_DECODE) {
+        draw_decoded(&decode_ring);
+    } else if (screen == SCREEN_GLITCH) {
+        draw_glitches(&glitch_catcher);
+    } else if (screen == SCREEN_COUNTER) {
+        draw_counter(freq_mhz, freqmeter.gate_ms);
+    } else {
+        draw_analysis_result(res, edges, first_run, freq_mhz, display_samples);
+    }
+}
+
+#ifdef ANALYZER_BENCHMARK
+// cycles spent evaluating expr, derived from the 1 MHz timer and the system clock
+#define MEASURE_CYCLES(cycles, expr) do { \
+        uint64_t t0 = time_us_64(); \
+        expr; \
+        cycles = (time_us_64() - t0) * (clock_get_hz(clk_sys) / 1000000); \
+    } while (0)
+
+#define MEASUREMENT_REPEAT 100
+
+// The measurement path as it was before the integer units: float results and %f formatting
+static void float_measurement(const edge_list_t *list, double sample_rate, char *freq_text, char *duty_text) {
+    float duty = ((float)list->high_count / (float)list->total_samples) * 100.0f;
+    double duration = (double)list->total_samples / sample_rate;
+    double freq = ((list->rising + list->falling) / 2.0) / duration;
+    sprintf(freq_text, "%.3f KHz", freq / 1000.0);
+    sprintf(duty_text, "Duty %.1f%%", duty);
+}
+
+static void fixed_measurement(const edge_list_t *list, uint32_t sample_rate, char *freq_text, char *duty_text) {
+    analysis_result_t res = analyze_edge_list(list, sample_rate);
+    printFreqMilliHz(freq_text, res.estimated_freq_mhz);
+    strcpy(duty_text, "Duty ");
+    printPercent(&duty_text[5], res.duty_bp);
+}
+
+void benchmark_analyzer(uint32_t sample_rate) {
+    uint64_t word_cycles, bit_cycles, float_cycles, fixed_cycles;
+    analysis_result_t word_res, bit_res;
+    char freq_text[16], duty_text[16];
+
+    start_capture(&sampler);
+    wait_capture_blocking(&sampler);
+    stop_capture(&sampler);
+
+    MEASURE_CYCLES(word_cycles, word_res = analyze_signal_buffer(sampler.sample_buffer, BUFFER_SIZE, sample_rate));
+    MEASURE_CYCLES(bit_cycles, bit_res = analyze_signal_buffer_bitwise(sampler.sample_buffer, BUFFER_SIZE, sample_rate));
+
+    printf("Analyzer benchmark (%d samples, %lu transitions):\n", BUFFER_SIZE * 32, (unsigned long)word_res.transitions);
+    printf("  word-parallel: %llu cycles (%.2f cycles/sample)\n", word_cycles, (double)word_cycles / (BUFFER_SIZE * 32));
+    printf("  bit-serial:    %llu cycles (%.2f cycles/sample)\n", bit_cycles, (double)bit_cycles / (BUFFER_SIZE * 32));
+    printf("  results %s\n", memcmp(&word_res, &bit_res, sizeof(word_res)) == 0 ? "match" : "DIFFER");
+
+    edge_list_t *list = &edge_lists[0];
+    edge_list_build(list, sampler.sample_buffer, BUFFER_SIZE);
+    MEASURE_CYCLES(float_cycles, for (int i = 0; i < MEASUREMENT_REPEAT; i++) float_measurement(list, sample_rate, freq_text, duty_text));
+    printf("  float measurement: %llu cycles per capture (%s, %s)\n", float_cycles / MEASUREMENT_REPEAT, freq_text, duty_text);
+    MEASURE_CYCLES(fixed_cycles, for (int i = 0; i < MEASUREMENT_REPEAT; i++) fixed_measurement(list, sample_rate, freq_text, duty_text));
+    printf("  fixed measurement: %llu cycles per capture (%s, %s)\n", fixed_cycles / MEASUREMENT_REPEAT, freq_text, duty_text);
+}
+#endif
+
+// Frequency from the hardware counters, 0 without a reading. The reciprocal counter
+// resolves far better than edges per capture while it can follow the signal, above
+// it the gated edge counter still counts up to half the system clock. The choice
+// goes by the edge counter: the sampled estimate aliases above half the sample
+// rate, which is where the reciprocal counter gives up in the standard profile.
+uint64_t hardware_freq(uint64_t counter_freq, uint64_t edge_freq) {
+#if EDGE_COUNTER_ENABLED
+    if (edge_freq >= freqmeter_max_freq(&freqmeter) || counter_freq == 0) return edge_freq;
+#else
+    (void)edge_freq;
+#endif
+    return counter_freq;
+}
+
+// Buttons raise events from the GPIO and alarm interrupts of core0 and core1
+// takes them between frames, so a setting is on screen within a frame
+button_queue_t button_events;
+Button btn_left;
+Button btn_right;
+
+// A click steps display_samples by one, hold and repeat by a factor of 2
+void handle_buttons(const button_event_t *event, uint32_t *display_samples) {
+    bool step = event->type == BUTTON_CLICK;
+    if (event->pin == BTN_LEFT_PIN) {
+        if (*display_samples < MAX_DISPLAY_SAMPLES) *display_samples = step ? *display_samples + 1 : *display_samples * 2;
+    } else {
+        if (*display_samples > MIN_DISPLAY_SAMPLES) *display_samples = step ? *display_samples - 1 : *display_samples / 2;
+    }
+}
+
+// Zoom screen: a click pans by a quarter of the window, hold and repeat zoom
+// in (left) or out (right) around the middle of the window
+void handle_zoom_buttons(const button_event_t *event, uint32_t *zoom, uint32_t *offset) {
+    uint32_t total = capture_samples;
+    uint32_t window = oled.width << *zoom;
+    bool click = event->type == BUTTON_CLICK;
+
+    if (event->pin == BTN_LEFT_PIN) {
+        if (click) {
+            *offset = *offset > window / 4 ? *offset - window / 4 : 0;
+        } else if (*zoom > 0) {
+            (*zoom)--;
+            *offset += window / 4;
+        }
+    } else {
+        if (click) {
+            *offset += window / 4;
+        } else if (window < total) {
+            (*zoom)++;
+            *offset = *offset > window / 2 ? *offset - window / 2 : 0;
+        }
+    }
+
+    window = oled.width << *zoom;
+    if (*offset + window > total) *offset = total > window ? total - window : 0;
+    // whole columns: the pyramid reads bucket offset >> zoom, anything below would shift the view
+    *offset &= ~((1u << *zoom) - 1);
+}
+
+// Glitch screen: a short press halves (left) or doubles (right) the threshold
+// when the button comes up, holding either clears the latched count and
+// leaves the threshold as it was
+void handle_glitch_buttons(const button_event_t *event) {
+    if (event->type == BUTTON_HOLD) {
+        glitch_catcher_clear(&glitch_catcher);
+    } else if (event->type == BUTTON_SHORT) {
+        uint32_t cycles = glitch_catcher.threshold_cycles;
+        glitch_catcher_set_threshold(&glitch_catcher, event->pin == BTN_LEFT_PIN ? cycles / 2 : cycles * 2);
+    }
+}
+
+// Counter screen: a click shortens (left) or lengthens (right) the gate by a
+// factor of 10, the next reading comes with the new gate
+void handle_counter_buttons(const button_event_t *event) {
+    if (event->type != BUTTON_CLICK) return;
+    uint32_t gate_ms = freqmeter.gate_ms;
+    if (event->pin == BTN_LEFT_PIN) {
+        if (gate_ms > FREQMETER_SHORTEST_GATE_MS) freqmeter_set_gate(&freqmeter, gate_ms / 10);
+    } else {
+        if (gate_ms < FREQMETER_LONGEST_GATE_MS) freqmeter_set_gate(&freqmeter, gate_ms * 10);
+    }
+}
+
+// Both buttons down together switch the screen: the press of the second one
+// does, the hold and repeat events while both are down do nothing, and
+// neither release counts as a short press
+void handle_button_event(const button_event_t *event) {
+    static bool chord = false; // since the last press: both were down
+    uint8_t both = (1u << btn_left.index) | (1u << btn_right.index);
+    if (event->type == BUTTON_CLICK) chord = false;
+    if ((event->pressed & both) == both) {
+        if (event->type == BUTTON_CLICK) display_screen = (display_screen + 1) % SCREEN_COUNT;
+        chord = true;
+        return;
+    }
+    if (chord && event->type == BUTTON_SHORT) return;
+
+    if (display_screen == SCREEN_GLITCH) {
+        handle_glitch_buttons(event);
+    } else if (display_screen == SCREEN_COUNTER) {
+        handle_counter_buttons(event);
+    } else if (display_screen == SCREEN_ZOOM) {
+        uint32_t zoom = display_zoom;
+        uint32_t offset = display_offset;
+        handle_zoom_buttons(event, &zoom, &offset);
+        display_zoom = zoom;
+        display_offset = offset;
+    } else {
+        uint32_t display_samples_now = display_samples;
+        handle_buttons(event, &display_samples_now);
+        display_samples = display_samples_now;
+    }
+}
+
+// Core1: analysis, UART report and OLED. Each block received from core0 is
+// appended to the edge lists and released right away. A capture of the
+// gapless stream spans consecutive blocks until its estimate settles or it
+// reaches the buffer depth; triggered and run-length captures are single
+// blocks. The rest of the work runs on the edge lists of the whole capture
+// while the sampler refills the blocks.
+void core1_main() {
     bool signal_detected = false;
     uint32_t inactive_captures = 0;
     uint32_t capture_count = 0;
-    uint32_t min_display_samples = MIN_DISPLAY_SAMPLES;
-    uint32_t max_display_samples = MAX_DISPLAY_SAMPLES;
-    uint32_t display_samples = DISPLAY_SAMPLES;
+    uint32_t drawn_display_samples = display_samples;
+    uint32_t drawn_screen = display_screen;
+    uint32_t drawn_zoom = display_zoom;
+    uint32_t drawn_offset = display_offset;
+    uint32_t drawn_gate = freqmeter.gate_ms;
+    uint32_t drawn_glitches = 0;
+    uint32_t drawn_threshold = 0;
+    uint64_t glitch_led_until = 0;
+    uint64_t redraw_at = 0;
+    bool have_result = false; // shown_list holds the last active capture
+    bool pyramid_shown = false; // and the pyramid still belongs to it
+    analysis_result_t analysis;
+    uint64_t counter_freq = 0; // milli-Hz
+    uint64_t edge_freq = 0;
+    uint64_t display_freq = 0;
+    uint32_t trigger_run = 0; // display starts at the run holding the trigger
+    uint32_t analysis_rate = 0; // sample rate of the capture analysed
+
+    // totals over the gapless stream of blocks
+    uint64_t stream_samples = 0;
+    uint64_t stream_high = 0;
+    uint64_t stream_transitions = 0;
+    uint32_t last_seq = 0;
+    uint32_t last_level = 0;
+    edge_list_t *edge_list = &edge_lists[0];
+
+    // capture open across blocks, 0 words while none is
+    convergence_t convergence = {
+        .min_transitions = CONVERGE_MIN_TRANSITIONS,
+        .agree_blocks = CONVERGE_AGREE_BLOCKS,
+        .tolerance_ppm = CONVERGE_TOLERANCE_PPM,
+        .duty_tolerance_bp = CONVERGE_DUTY_TOLERANCE_BP
+    };
+    uint32_t capture_words = 0; // per channel
+    uint32_t capture_rate = 0;
+    uint32_t capture_first_seq = 0;
+    bool capture_joins_stream = false;
+    uint32_t first_words[10];
+
     while (true) {
-        
+        button_event_t event;
+        while (button_queue_pop(&button_events, &event)) {
+            handle_button_event(&event);
+        }
+        freqmeter_poll(&freqmeter, &counter_freq);
+#if EDGE_COUNTER_ENABLED
+        edge_counter_poll(&edge_counter, &edge_freq);
+#endif
+        uart_telemetry_poll(&telemetry);
+
+        // glitch alarms show at once, not with the next capture
+        uint64_t glitch_us;
+        if (glitch_catcher_poll(&glitch_catcher, &glitch_us)) {
+            set_rgb(127, 0, 127, &ws2812);
+            glitch_led_until = glitch_us + GLITCH_LED_MS * 1000ull;
+        }
+        if (display_screen == SCREEN_GLITCH && (drawn_screen != SCREEN_GLITCH || drawn_glitches != glitch_catcher_count(&glitch_catcher) ||
+                                                drawn_threshold != glitch_catcher.threshold_cycles)) {
+            drawn_screen = SCREEN_GLITCH;
+            drawn_glitches = glitch_catcher_count(&glitch_catcher);
+            drawn_threshold = glitch_catcher.threshold_cycles;
+            draw_glitches(&glitch_catcher);
+        }
+        bool glitch_led = time_us_64() < glitch_led_until;
+
+        // keep the display in step with the settings between captures, however
+        // busy the block stream is, at most once a refresh period
+        ssd1306_poll(&oled);
+        if (have_result && time_us_64() >= redraw_at && (drawn_display_samples != display_samples || drawn_screen != display_screen ||
+                                                          drawn_zoom != display_zoom || drawn_offset != display_offset ||
+                                                          drawn_gate != freqmeter.gate_ms)) {
+            drawn_display_samples = display_samples;
+            drawn_screen = display_screen;
+            drawn_zoom = display_zoom;
+            drawn_offset = display_offset;
+            drawn_gate = freqmeter.gate_ms;
+            draw_screen(drawn_screen, &analysis, analysis_rate, pyramid_shown ? &pyramid : &no_pyramid, &shown_list, trigger_run,
+                        display_freq, drawn_display_samples, drawn_zoom, drawn_offset);
+            redraw_at = time_us_64() + DISPLAY_REFRESH_US;
+        }
+
+        uint32_t block_index;
+        if (!multicore_fifo_pop_timeout_us(DISPLAY_REFRESH_US, &block_index)) continue;
+        sampler_block_t *block = &sampler.blocks[block_index];
+        uint32_t block_rate = (uint32_t)block->sample_rate;
+        uint32_t trigger_sample = block->trigger_sample;
+        bool rle = block->rle;
+        bool single = rle || trigger_sample != SAMPLER_NO_TRIGGER;
+        // a retune restarts the stream, its blocks count from 1 again
+        bool follows = block->seq == last_seq + 1 && block_rate == capture_rate;
+
+        if (single || capture_words == 0 || !follows) {
+            // an open capture cut off by a gap is dropped, its samples are not contiguous
+            for (uint c = 0; c < SIGNAL_CHANNELS; c++) {
+                edge_list_reset(&edge_lists[c]);
+            }
+            pyramid_reset(&pyramid);
+            pyramid_shown = false;
+            convergence_reset(&convergence);
+            memcpy(first_words, block->data, sizeof(first_words));
+            capture_joins_stream = !single && capture_words == 0 && follows;
+            capture_words = 0;
+            capture_rate = block_rate;
+            capture_first_seq = block->seq;
+        }
+
+        if (rle) {
+            // run-length captures hold channel 0 only, no samples to build the
+            // pyramid from: the zoom screen reads the runs
+            edge_list_append_rle(edge_list, block->data, block->word_count);
+        } else {
+            deinterleave_channels(block->data, block->word_count, SIGNAL_CHANNELS);
+            for (uint c = 0; c < SIGNAL_CHANNELS; c++) {
+                edge_list_append_strided(&edge_lists[c], block->data + c, block->word_count / SIGNAL_CHANNELS, SIGNAL_CHANNELS);
+            }
+            pyramid_append(&pyramid, block->data, block->word_count / SIGNAL_CHANNELS, SIGNAL_CHANNELS);
+        }
+        capture_words += block->word_count / SIGNAL_CHANNELS;
+        last_seq = block->seq;
+        // the block is refilled once released, the record needs its description
+        const sampler_block_t header = *block;
+        bool intact = sampler_release_block(&sampler, block);
+        blocks_released++;
+        if (!intact) {
+            // refilled while it was read, the capture it belongs to is dropped
+            DEBUG_PRINTF(1, "Block #%lu overwritten, capture dropped\n", header.seq);
+            capture_words = 0;
+            continue;
+        }
+
+        bool converged = convergence_update(&convergence, edge_list);
+        if (!single && !converged && capture_words < BUFFER_SIZE / SIGNAL_CHANNELS) continue;
+
+        for (uint c = 0; c < SIGNAL_CHANNELS; c++) {
+            edge_list_finish(&edge_lists[c]);
+        }
+        pyramid_finish(&pyramid);
+        capture_samples = edge_list->total_samples;
+        capture_words = 0;
         capture_count++;
-        
-        printf("[%lu] Starting capture... ", capture_count);
 
-        start_capture(&sampler);
-        wait_capture_blocking(&sampler);
-        stop_capture(&sampler);
-        
-        bool activity = detect_signal_activity(sampler.sample_buffer, BUFFER_SIZE);
+        DEBUG_PRINTF(1, "[%lu] Blocks #%lu..%lu at %lu S/s (overruns %lu)%s... ", capture_count, capture_first_seq, header.seq,
+                     block_rate, sampler.overruns, converged ? ", converged" : "");
+        if (trigger_sample != SAMPLER_NO_TRIGGER) {
+            DEBUG_PRINTF(1, "trigger at sample %lu... ", trigger_sample);
+        }
+
+        // the edge between two consecutive captures belongs to neither of them,
+        // triggered captures are separate windows
+        if (capture_joins_stream && edge_list->first_level != last_level) {
+            stream_transitions++;
+        }
+        last_level = edge_list->level;
+
+        stream_samples += edge_list->total_samples;
+        stream_high += edge_list->high_count;
+        stream_transitions += edge_list->rising + edge_list->falling;
+
+        bool activity = detect_signal_activity(edge_list);
+
+        // retune when the rate set is more than a factor of 2 off the target, run-length
+        // captures keep the finest resolution. Triggered blocks may be sampled slower than
+        // the rate set, so that is what the target is held against, not block_rate.
+        double next_rate = sampler_autorange_rate(&sampler, block_rate, edge_list->rising + edge_list->falling,
+                                                  edge_list->total_samples, AUTORANGE_TARGET_PERIODS, AUTORANGE_MAX_CAPTURE_MS);
+        double set_rate = sampler.sample_rate;
+        if (!rle && (next_rate > set_rate * 2.0 || next_rate < set_rate / 2.0)) {
+            requested_sample_rate = (uint32_t)next_rate;
+        }
         
         if (activity) {
             signal_detected = true;
             inactive_captures = 0;
-            printf("ACTIVE");
-            analysis_result_t analysis = analyze_signal_buffer(sampler.sample_buffer, BUFFER_SIZE, sample_rate);
+            DEBUG_PRINTF(1, "ACTIVE\n");
+            analysis = analyze_edge_list(edge_list, block_rate);
+            memcpy(analysis.first_words, first_words, sizeof(analysis.first_words));
+            have_result = true;
+            trigger_run = trigger_sample == SAMPLER_NO_TRIGGER ? 0 : edge_list_run_at(edge_list, trigger_sample);
+            analysis_rate = block_rate;
+
+            uint64_t hw_freq = hardware_freq(counter_freq, edge_freq);
+            display_freq = hw_freq > 0 ? hw_freq : analysis.estimated_freq_mhz;
 
-            print_analysis_result(&analysis, capture_count, sampler.sample_buffer, sample_rate, display_samples);
-            set_rgb(0, 0, 127, &ws2812);
+            eye_accumulate(&eye, edge_list);
+            ets_fold(&ets, edge_list);
+            ets_rate = block_rate;
+
+#ifdef SIGNAL_DECODE
+            uint32_t decoded = decode_capture(&decoder, &decode_ring);
+            decode_baud = decoder.bit_q8 ? (uint32_t)(((uint64_t)block_rate << 8) / decoder.bit_q8) : 0;
+#endif
+
+            drawn_display_samples = display_samples;
+            drawn_screen = display_screen;
+            drawn_zoom = display_zoom;
+            drawn_offset = display_offset;
+            drawn_gate = freqmeter.gate_ms;
+            draw_screen(drawn_screen, &analysis, analysis_rate, &pyramid, edge_list, trigger_run, display_freq, drawn_display_samples,
+                        drawn_zoom, drawn_offset);
+            redraw_at = time_us_64() + DISPLAY_REFRESH_US;
+            send_telemetry(&header, capture_count, &analysis, edge_lists, trigger_run, display_freq, hw_freq);
+#ifdef SIGNAL_DECODE
+            send_decoded_frames(capture_count, SIGNAL_DECODE, decoded, decoder.truncated);
+#endif
+#if DEBUG_LEVEL >= 2
+            uart_telemetry_flush(&telemetry);
+            print_analysis_result(&analysis, capture_count, edge_list, trigger_run);
+#ifdef SIGNAL_DECODE
+            printf("Decoded %lu frames%s:", decoded, decoder.truncated ? " (edge list full, cut short)" : "");
+            for (uint32_t i = decoded < DECODE_RING_SIZE ? decoded : DECODE_RING_SIZE; i > 0; i--) {
+                const decoded_frame_t *frame = decode_ring_get(&decode_ring, i - 1);
+                printf(" %02X/%x", frame->value, frame->flags);
+            }
+            printf("\n");
+#endif
+            for (uint c = 1; c < SIGNAL_CHANNELS; c++) {
+                analysis_result_t channel = analyze_edge_list(&edge_lists[c], block_rate);
+                printf("CH%u: %lu transitions, duty %lu.%02lu%%, %llu Hz\n", c, channel.transitions,
+                       channel.duty_bp / 100, channel.duty_bp % 100, channel.estimated_freq_mhz / 1000);
+            }
+            printf("Reciprocal frequency: %llu.%03llu Hz (gate %lu ms)\n", counter_freq / 1000, counter_freq % 1000, freqmeter.gate_ms);
+#if EDGE_COUNTER_ENABLED
+            printf("Edge counter: %llu.%03llu Hz (gate %lu ms)\n", edge_freq / 1000, edge_freq % 1000, edge_counter.gate_ms);
+#endif
+            printf("Stream: %llu samples, %llu transitions, duty %.2f%%\n",
+                   stream_samples, stream_transitions, (stream_high * 100.0) / stream_samples);
+#endif
+            if (!glitch_led) set_rgb(0, 0, 127, &ws2812);
 
+            // the capture becomes the one shown, the next is appended over the runs it replaces
+            edge_run_t *spare = shown_list.runs;
+            shown_list = *edge_list;
+            edge_list->runs = spare;
+            pyramid_shown = true;
 
         } else {
             inactive_captures++;
-            printf("NO SIGNAL");
-            set_rgb(45, 45, 0, &ws2812);
-            ssd1306_fill(&oled, 0);
-            ssd1306_draw_string(&oled, 1, 1, "No signal!");
-            ssd1306_show(&oled);
+            have_result = false;
+            DEBUG_PRINTF(1, "NO SIGNAL\n");
+            send_telemetry(&header, capture_count, NULL, edge_lists, 0, 0, hardware_freq(counter_freq, edge_freq));
+            if (!glitch_led) set_rgb(45, 45, 0, &ws2812);
+            if (display_screen != SCREEN_GLITCH) {
+                ssd1306_fill(&oled, 0);
+                ssd1306_draw_string(&oled, 1, 1, "No signal!");
+                ssd1306_show_async(&oled);
+            }
             if (inactive_captures % 10 == 0) {
-                printf(" (%lu consecutive no-signal captures)\n", inactive_captures);
+                DEBUG_PRINTF(1, "(%lu consecutive no-signal captures)\n", inactive_captures);
             }
             
             if (signal_detected && inactive_captures == 1) {
-                printf(">>> Signal lost after %lu active captures <<<\n", capture_count - inactive_captures);
+                DEBUG_PRINTF(1, ">>> Signal lost after %lu active captures <<<\n", capture_count - inactive_captures);
                 signal_detected = false;
             }
         }
+    }
+}
+
+int main() {
+    stdio_init_all();
+    // the USB CDC port carries the SUMP protocol, printf stays on the UART
+    stdio_set_driver_enabled(&stdio_usb, false);
+    // before any peripheral, they all take their dividers from the new clocks
+    const sampler_profile_t *profile = &sampler_profiles[TIMEBASE_PROFILE];
+    bool profile_applied = sampler_apply_profile(&sampler, profile);
+
+    button_queue_init(&button_events);
+    button_init(&btn_left, BTN_LEFT_PIN, &button_events);
+    button_init(&btn_right, BTN_RIGHT_PIN, &button_events);
+    
+    ws2812_init(&ws2812);
+    set_rgb(127, 0, 0, &ws2812);
+
+    setup_uart(DBG_UART_ID, DBG_UART_BAUDRATE, DBG_UART_TX_PIN, DBG_UART_RX_PIN, DBG_UART_DATA_BITS, DBG_UART_STOP_BITS, DBG_PARITY);
+    stdio_uart_init();
+    uart_telemetry_init(&telemetry, DBG_UART_ID);
+
+    printf("Starting...");
+    printf("System clock set to %lu MHz\n", (unsigned long)(clock_get_hz(clk_sys) / 1000000.));
+    if (!profile_applied) {
+        printf("Timebase profile %s (%lu MHz) not reachable, staying at the default clock\n", profile->name, profile->sys_hz / 1000000);
+    }
+
+    if (!ssd1306_init(&oled)) {
+        printf("No OLED at 0x%02x, the display stays dark\n", oled.address);
+    }
+    ssd1306_fill(&oled, 255);
+    ssd1306_show(&oled);
+
+    sample_rate = (uint32_t)setup_sampler(&sampler);
+    // the microsecond timer runs from the crystal: a rate off here means a wrong clock or a DMA falling behind
+    uint32_t measured_rate = (uint32_t)sampler_measure_sample_rate(&sampler);
+    uint32_t deviation = measured_rate > sample_rate ? measured_rate - sample_rate : sample_rate - measured_rate;
+    bool timebase_ok = (uint64_t)deviation * 1000 <= (uint64_t)sample_rate * TIMEBASE_TOLERANCE_PERMILLE;
+    setup_freqmeter(&freqmeter);
+#if EDGE_COUNTER_ENABLED
+    // after the sampler: the PIO still reads the pin with the PWM function selected
+    setup_edge_counter(&edge_counter);
+#endif
+    // after the LED, which takes state machine 0 of the same PIO
+    glitch_catcher.threshold_cycles = (uint64_t)GLITCH_CATCHER_THRESHOLD_NS * clock_get_hz(clk_sys) / 1000000000u;
+    setup_glitch_catcher(&glitch_catcher);
+    for (uint c = 0; c < SIGNAL_CHANNELS; c++) {
+        edge_list_init(&edge_lists[c], edge_runs[c], EDGE_LIST_SIZE);
+        edge_list_set_glitch_threshold(&edge_lists[c], GLITCH_THRESHOLD);
+    }
+    edge_list_init(&shown_list, shown_runs, EDGE_LIST_SIZE);
+    pyramid_init(&pyramid, pyramid_storage, PYRAMID_SIZE);
+    eye_init(&eye, EYE_DECAY_SHIFT);
+    sump_init(&sump, &sampler);
+    
+    printf("Configuration:\n");
+    printf("  Sample pins: GPIO%d..GPIO%d\n", SIGNAL_PIN, SIGNAL_PIN + SIGNAL_CHANNELS - 1);
+    printf("  Timebase: %s, clkdiv %.2f\n", sampler.profile ? sampler.profile->name : "default", sampler.clkdiv);
+    printf("  Sample rate: %lu, measured %lu%s\n", sample_rate, measured_rate, timebase_ok ? "" : " - TIMEBASE MISMATCH");
+    printf("  Buffer size: %d words (%d samples), %d blocks\n", BUFFER_SIZE, BUFFER_SIZE * 32, SAMPLER_BLOCKS);
+    printf("  Starting continuous capture...\n\n");
+    sleep_ms(200);
+
+#ifdef ANALYZER_BENCHMARK
+    benchmark_analyzer(sample_rate);
+#endif
+    
+    multicore_launch_core1(core1_main);
+
+    // at most one block is handed to core1 at a time; blocks filled while it
+    // is busy stay with the sampler and show up as overruns
+    uint32_t blocks_sent = 0;
+    bool sump_active = false;
+#ifdef SIGNAL_TRIGGER
+    const sampler_trigger_t trigger = {
+        .mode = SIGNAL_TRIGGER,
+        .channel = 0,
+        .pre_percent = TRIGGER_PRE_PERCENT
+    };
+    bool capturing = false;
+    uint64_t capture_start_us = 0;
+#elif defined(SIGNAL_RLE)
+    bool capturing = false;
+    uint64_t capture_start_us = 0;
+#else
+    start_continuous_capture(&sampler);
+#endif
+    while (true) {
+        // a run from the SUMP host takes the sampler over once core1 is idle
+        if (sump_poll(&sump)) {
+            if (sump.state == SUMP_ARMED && blocks_released == blocks_sent) {
+#if defined(SIGNAL_TRIGGER)
+                sampler_block_t *block = capturing ? stop_triggered_capture(&sampler) : NULL;
+                if (block) sampler_release_block(&sampler, block);
+                capturing = false;
+#elif defined(SIGNAL_RLE)
+                sampler_block_t *block = capturing ? stop_rle_capture(&sampler) : NULL;
+                if (block) sampler_release_block(&sampler, block);
+                capturing = false;
+#else
+                stop_continuous_capture(&sampler);
+#endif
+                sump_start(&sump);
+                sump_active = true;
+            }
+            continue;
+        }
+        if (sump_active) {
+            sump_active = false;
+#if !defined(SIGNAL_TRIGGER) && !defined(SIGNAL_RLE)
+            start_continuous_capture(&sampler);
+#endif
+        }
+
+        if (blocks_released != blocks_sent) continue;
+
+        uint32_t rate = requested_sample_rate;
+        if (rate) {
+            requested_sample_rate = 0;
+            sampler_set_sample_rate(&sampler, rate);
+        }
 
-        // Left button
-        button_tick(&btn1);
-        if (button_click(&btn1)) {
-            if (display_samples < max_display_samples) display_samples++;
+#ifdef SIGNAL_TRIGGER
+        // the ring reuses the whole buffer, so the next capture starts once core1 is done
+        if (!capturing) {
+            start_triggered_capture(&sampler, &trigger);
+            capture_start_us = time_us_64();
+            capturing = true;
         }
-        if (button_hold(&btn1)) {
-            if (display_samples < max_display_samples) display_samples = display_samples * 2;
+        sampler_block_t *block = poll_triggered_capture(&sampler);
+        if (!block) {
+            if (time_us_64() - capture_start_us < TRIGGER_TIMEOUT_MS * 1000ull) continue;
+            block = stop_triggered_capture(&sampler);
         }
-        // Right button
-        button_tick(&btn2);
-        if (button_click(&btn2)) {
-            if (display_samples > min_display_samples) display_samples--;
+        capturing = false;
+#elif defined(SIGNAL_RLE)
+        if (!capturing) {
+            start_rle_capture(&sampler);
+            capture_start_us = time_us_64();
+            capturing = true;
         }
-        if (button_hold(&btn2)) {
-            if (display_samples > min_display_samples) display_samples = display_samples / 2;
+        sampler_block_t *block = poll_rle_capture(&sampler);
+        if (!block) {
+            if (time_us_64() - capture_start_us < RLE_WINDOW_MS * 1000ull) continue;
+            block = stop_rle_capture(&sampler);
         }
+        capturing = false;
+#else
+        sampler_block_t *block = sampler_get_block(&sampler);
+        if (!block) continue;
+#endif
 
-        // sleep_ms(3000);
+        blocks_sent++;
+        multicore_fifo_push_blocking(block - sampler.blocks);
     }
     
     return 0;